@@ -0,0 +1,257 @@
+#include "cell_grid.h"
+#include "profile.h"
+
+static uint8_t s_cells[HEIGHT][WIDTH];
+static uint8_t s_prev_cells[HEIGHT][WIDTH];
+static uint8_t s_planes[NUM_CELL_PLANES][HEIGHT][WIDTH];
+
+// Lit column range per row, min > max for an empty row
+static int8_t s_row_min[HEIGHT];
+static int8_t s_row_max[HEIGHT];
+static int8_t s_prev_row_min[HEIGHT];
+static int8_t s_prev_row_max[HEIGHT];
+static int8_t s_plane_row_min[NUM_CELL_PLANES][HEIGHT];
+static int8_t s_plane_row_max[NUM_CELL_PLANES][HEIGHT];
+// Column range per row of the cells changed since the last blit
+static int8_t s_changed_min[HEIGHT];
+static int8_t s_changed_max[HEIGHT];
+
+// Where cell_grid_set draws: the frame, or a plane being baked
+static uint8_t (*s_target)[WIDTH] = s_cells;
+static int8_t *s_target_row_min = s_row_min;
+static int8_t *s_target_row_max = s_row_max;
+
+#if defined(PROFILE_RENDER)
+// cell_grid_set calls since the last commit
+static uint32_t s_fill_calls;
+#endif
+
+void cell_grid_bake_begin(CellPlane plane){
+  memset(s_planes[plane], GColorClearARGB8, sizeof(s_planes[plane]));
+  for(int16_t j = 0; j < HEIGHT; j++){
+    s_plane_row_min[plane][j] = WIDTH;
+    s_plane_row_max[plane][j] = -1;
+  }
+  s_target = s_planes[plane];
+  s_target_row_min = s_plane_row_min[plane];
+  s_target_row_max = s_plane_row_max[plane];
+}
+
+void cell_grid_bake_end(void){
+  s_target = s_cells;
+  s_target_row_min = s_row_min;
+  s_target_row_max = s_row_max;
+}
+
+// Color of one pixel, in any format a resource loads as
+static GColor bitmap_pixel(GBitmap *bitmap, int16_t x, int16_t y){
+  GBitmapDataRowInfo row = gbitmap_get_data_row_info(bitmap, y);
+  const GColor *palette = gbitmap_get_palette(bitmap);
+  
+  switch(gbitmap_get_format(bitmap)){
+  case GBitmapFormat1Bit:
+    return (row.data[x / 8] >> (x % 8)) & 1 ? GColorWhite : GColorBlack;
+  case GBitmapFormat1BitPalette:
+    return palette[(row.data[x / 8] >> (7 - x % 8)) & 0x1];
+  case GBitmapFormat2BitPalette:
+    return palette[(row.data[x / 4] >> (2 * (3 - x % 4))) & 0x3];
+  case GBitmapFormat4BitPalette:
+    return palette[(row.data[x / 2] >> (4 * (1 - x % 2))) & 0xF];
+  default:
+    if(x < row.min_x || x > row.max_x){
+      return GColorClear;
+    }
+    return (GColor){.argb = row.data[x]};
+  }
+}
+
+void cell_grid_bake_bitmap(GBitmap *bitmap, int16_t x, int16_t y){
+  GSize size = gbitmap_get_bounds(bitmap).size;
+  
+  for(int16_t j = 0; j * RECTHEIGHT < size.h; j++){
+    for(int16_t i = 0; i * RECTWIDTH < size.w; i++){
+      GColor color = bitmap_pixel(bitmap, i * RECTWIDTH, j * RECTHEIGHT);
+      if(color.a != 0){
+        cell_grid_set(x + i, y + j, color);
+      }
+    }
+  }
+}
+
+void cell_grid_clear(void){
+  memcpy(s_cells, s_planes[CELL_PLANE_UNDER], sizeof(s_cells));
+  memcpy(s_row_min, s_plane_row_min[CELL_PLANE_UNDER], sizeof(s_row_min));
+  memcpy(s_row_max, s_plane_row_max[CELL_PLANE_UNDER], sizeof(s_row_max));
+}
+
+void cell_grid_set(int16_t x, int16_t y, GColor color){
+  if(x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT){
+    return;
+  }
+  #if defined(PROFILE_RENDER)
+  s_fill_calls++;
+  #endif
+  s_target[y][x] = color.argb;
+  
+  if(x < s_target_row_min[y]){
+    s_target_row_min[y] = x;
+  }
+  if(x > s_target_row_max[y]){
+    s_target_row_max[y] = x;
+  }
+}
+
+void cell_grid_fill_span(int16_t x, int16_t y, int16_t len, GColor color){
+  int16_t last = x + len - 1;
+  if(x < 0){
+    x = 0;
+  }
+  if(last >= WIDTH){
+    last = WIDTH - 1;
+  }
+  if(y < 0 || y >= HEIGHT || x > last){
+    return;
+  }
+  #if defined(PROFILE_RENDER)
+  s_fill_calls++;
+  #endif
+  memset(&s_target[y][x], color.argb, last - x + 1);
+  
+  if(x < s_target_row_min[y]){
+    s_target_row_min[y] = x;
+  }
+  if(last > s_target_row_max[y]){
+    s_target_row_max[y] = last;
+  }
+}
+
+void cell_grid_overlay(void){
+  for(int16_t j = 0; j < HEIGHT; j++){
+    int16_t lo = s_plane_row_min[CELL_PLANE_OVER][j];
+    int16_t hi = s_plane_row_max[CELL_PLANE_OVER][j];
+    for(int16_t i = lo; i <= hi; i++){
+      uint8_t color = s_planes[CELL_PLANE_OVER][j][i];
+      if(color != GColorClearARGB8){
+        s_cells[j][i] = color;
+      }
+    }
+    if(lo < s_row_min[j]){
+      s_row_min[j] = lo;
+    }
+    if(hi > s_row_max[j]){
+      s_row_max[j] = hi;
+    }
+  }
+}
+
+GRect cell_grid_commit(void){
+  #if defined(PROFILE_RENDER)
+  PROFILE_COUNT(PROFILE_FILL_CALLS, s_fill_calls);
+  s_fill_calls = 0;
+  #endif
+  
+  int16_t min_x = WIDTH, max_x = -1;
+  int16_t min_y = HEIGHT, max_y = -1;
+  
+  for(int16_t j = 0; j < HEIGHT; j++){
+    // Only the union of the old and new lit ranges can have changed
+    int16_t lo = s_row_min[j] < s_prev_row_min[j] ? s_row_min[j] : s_prev_row_min[j];
+    int16_t hi = s_row_max[j] > s_prev_row_max[j] ? s_row_max[j] : s_prev_row_max[j];
+    if(lo > hi){
+      continue;
+    }
+    
+    for(int16_t i = lo; i <= hi; i++){
+      if(s_cells[j][i] != s_prev_cells[j][i]){
+        if(i < min_x){
+          min_x = i;
+        }
+        if(i > max_x){
+          max_x = i;
+        }
+        if(j < min_y){
+          min_y = j;
+        }
+        max_y = j;
+        
+        if(i < s_changed_min[j]){
+          s_changed_min[j] = i;
+        }
+        if(i > s_changed_max[j]){
+          s_changed_max[j] = i;
+        }
+      }
+    }
+    
+    memcpy(&s_prev_cells[j][lo], &s_cells[j][lo], hi - lo + 1);
+    s_prev_row_min[j] = s_row_min[j];
+    s_prev_row_max[j] = s_row_max[j];
+  }
+  
+  if(max_x < 0){
+    return GRectZero;
+  }
+  return GRect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
+}
+
+void cell_grid_blit(GContext *ctx, GRect region, bool changed_only){
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if(fb == NULL){
+    return;
+  }
+  #if defined(PROFILE_RENDER)
+  uint32_t painted = 0;
+  #endif
+  
+  int16_t last_row = region.origin.y + region.size.h - 1;
+  int16_t last_col = region.origin.x + region.size.w - 1;
+  if(last_row >= HEIGHT){
+    last_row = HEIGHT - 1;
+  }
+  
+  for(int16_t j = region.origin.y < 0 ? 0 : region.origin.y; j <= last_row; j++){
+    int16_t first = s_row_min[j] > region.origin.x ? s_row_min[j] : region.origin.x;
+    int16_t last = s_row_max[j] < last_col ? s_row_max[j] : last_col;
+    if(changed_only){
+      first = s_changed_min[j] > first ? s_changed_min[j] : first;
+      last = s_changed_max[j] < last ? s_changed_max[j] : last;
+    }
+    if(first > last){
+      continue;
+    }
+    
+    for(int16_t py = j * RECTHEIGHT; py < (j + 1) * RECTHEIGHT - 1; py++){
+      GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, py);
+      
+      for(int16_t i = first; i <= last; i++){
+        uint8_t color = s_cells[j][i];
+        if(color == GColorClearARGB8){
+          continue;
+        }
+        #if defined(PROFILE_RENDER)
+        if(py == j * RECTHEIGHT){
+          painted++;
+        }
+        #endif
+        
+        // Clip the cell span to the visible part of the row (round displays)
+        int16_t x0 = i * RECTWIDTH;
+        int16_t x1 = x0 + RECTWIDTH - 2;
+        if(x0 < row.min_x){
+          x0 = row.min_x;
+        }
+        if(x1 > row.max_x){
+          x1 = row.max_x;
+        }
+        if(x0 <= x1){
+          memset(row.data + x0, color, x1 - x0 + 1);
+        }
+      }
+    }
+  }
+  
+  graphics_release_frame_buffer(ctx, fb);
+  memset(s_changed_min, WIDTH, sizeof(s_changed_min));
+  memset(s_changed_max, -1, sizeof(s_changed_max));
+  PROFILE_COUNT(PROFILE_CELLS_PAINTED, painted);
+}
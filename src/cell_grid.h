@@ -0,0 +1,55 @@
+#pragma once
+
+#include <pebble.h>
+
+#if defined(PBL_RECT)
+#define RECTWIDTH 4
+#define RECTHEIGHT  4
+#define WIDTH (144 / RECTWIDTH)
+#define HEIGHT (168 / RECTHEIGHT)
+#elif defined(PBL_ROUND)
+#define RECTWIDTH 4
+#define RECTHEIGHT 4
+#define WIDTH (180 / RECTWIDTH)
+#define HEIGHT (180 / RECTHEIGHT)
+#endif
+
+// Logical WIDTH x HEIGHT framebuffer of cells. Each cell holds a GColor8
+// value; GColorClear cells leave whatever is underneath untouched.
+//
+// Content that changes a few times a day is baked into two planes, one under
+// and one over the per-frame drawing, and only rebaked when it changes. A
+// frame starts as a copy of the under plane, draws the hands, lays the over
+// plane on top and commits.
+typedef enum {
+  CELL_PLANE_UNDER,
+  CELL_PLANE_OVER,
+  NUM_CELL_PLANES
+} CellPlane;
+
+// Clear plane and send cell_grid_set to it until cell_grid_bake_end
+void cell_grid_bake_begin(CellPlane plane);
+void cell_grid_bake_end(void);
+// Bake a bitmap whose top left is at cell x, y, one cell per RECTWIDTH x
+// RECTHEIGHT block sampled at its top left pixel. Transparent pixels leave
+// the cell as it is
+void cell_grid_bake_bitmap(GBitmap *bitmap, int16_t x, int16_t y);
+
+// Start a frame from the under plane
+void cell_grid_clear(void);
+void cell_grid_set(int16_t x, int16_t y, GColor color);
+// Set a run of len cells of row y starting at x
+void cell_grid_fill_span(int16_t x, int16_t y, int16_t len, GColor color);
+// Lay the lit cells of the over plane on top of the frame
+void cell_grid_overlay(void);
+
+// Finish the frame drawn since the last clear. Returns the bounding box, in
+// cells, of every cell that differs from the previously committed frame, so
+// it covers both the old and the new footprint. Empty if nothing changed.
+GRect cell_grid_commit(void);
+
+// Expand every lit cell inside region (in cells) into the screen framebuffer
+// as a (RECTWIDTH-1) x (RECTHEIGHT-1) block, keeping the 1 pixel grid gap.
+// With changed_only, only the cells committed with a new color since the last
+// blit are painted, for when the framebuffer still holds the rest.
+void cell_grid_blit(GContext *ctx, GRect region, bool changed_only);
@@ -0,0 +1,132 @@
+#include "compositor.h"
+#include "cell_grid.h"
+#include "heap_budget.h"
+#include "profile.h"
+
+typedef struct {
+  GRect frame;
+  WidgetDrawProc draw;
+  bool dirty;
+} Widget;
+
+static Widget s_widgets[NUM_WIDGETS];
+static Layer *s_layer;
+static GRect s_screen;
+// Queued since the last frame, empty when nothing is
+static GRect s_pending;
+#if defined(PROFILE_RENDER)
+// Section the next frame is also timed as, NUM_PROFILE_SECTIONS for none
+static ProfileSection s_frame_section = NUM_PROFILE_SECTIONS;
+#endif
+
+//Bounding box of two rects, an empty rect is ignored
+static GRect merge_rect(GRect a, GRect b){
+  if(a.size.w == 0 || a.size.h == 0){
+    return b;
+  }
+  if(b.size.w == 0 || b.size.h == 0){
+    return a;
+  }
+  int16_t x0 = a.origin.x < b.origin.x ? a.origin.x : b.origin.x;
+  int16_t y0 = a.origin.y < b.origin.y ? a.origin.y : b.origin.y;
+  int16_t x1 = a.origin.x + a.size.w > b.origin.x + b.size.w ? a.origin.x + a.size.w : b.origin.x + b.size.w;
+  int16_t y1 = a.origin.y + a.size.h > b.origin.y + b.size.h ? a.origin.y + a.size.h : b.origin.y + b.size.h;
+  return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+static bool overlaps(GRect a, GRect b){
+  return a.origin.x < b.origin.x + b.size.w && b.origin.x < a.origin.x + a.size.w &&
+         a.origin.y < b.origin.y + b.size.h && b.origin.y < a.origin.y + a.size.h;
+}
+
+static void update_proc(Layer *layer, GContext *ctx){
+  PROFILE_START(start);
+  PROFILE_TALLY(PROFILE_REDRAWS);
+  GRect region = layer_get_frame(layer);
+
+  graphics_context_set_compositing_mode(ctx, GCompOpSet);
+  //Anything drawn covers the widgets above it, which then have to be redrawn
+  bool covered = false;
+  for(int i = 0; i < NUM_WIDGETS; i++){
+    Widget *widget = &s_widgets[i];
+    if(widget->draw != NULL && overlaps(widget->frame, region) &&
+       (widget->dirty || covered)){
+      widget->draw(ctx, widget->frame, region);
+      covered = true;
+    }
+    widget->dirty = false;
+  }
+  s_pending = GRectZero;
+  PROFILE_END(PROFILE_COMPOSITE, start);
+  #if defined(PROFILE_RENDER)
+  if(s_frame_section != NUM_PROFILE_SECTIONS){
+    profile_record(s_frame_section, start);
+    s_frame_section = NUM_PROFILE_SECTIONS;
+  }
+  #endif
+}
+
+Layer *compositor_create(GRect bounds){
+  s_screen = bounds;
+  s_pending = bounds;
+  s_layer = heap_layer_create(HEAP_LAYERS, bounds);
+  layer_set_update_proc(s_layer, update_proc);
+  return s_layer;
+}
+
+void compositor_destroy(void){
+  heap_layer_destroy(HEAP_LAYERS, s_layer);
+  s_layer = NULL;
+  memset(s_widgets, 0, sizeof(s_widgets));
+}
+
+void compositor_add(WidgetId id, GRect frame, WidgetDrawProc draw){
+  s_widgets[id] = (Widget) {
+    .frame = frame,
+    .draw = draw,
+    .dirty = true
+  };
+  compositor_mark_dirty(id);
+}
+
+void compositor_mark_dirty(WidgetId id){
+  compositor_mark_dirty_rect(id, s_widgets[id].frame);
+}
+
+void compositor_mark_dirty_rect(WidgetId id, GRect rect){
+  if(rect.size.w != 0 && rect.size.h != 0){
+    s_widgets[id].dirty = true;
+    s_pending = merge_rect(s_pending, rect);
+  }
+}
+
+void compositor_flush(void){
+  if(s_layer == NULL || s_pending.size.w == 0 || s_pending.size.h == 0){
+    return;
+  }
+
+  // Widen to whole cells, since the cell grid blits whole cells regardless of
+  // clipping, and keep it on screen
+  int16_t x0 = s_pending.origin.x / RECTWIDTH * RECTWIDTH;
+  int16_t y0 = s_pending.origin.y / RECTHEIGHT * RECTHEIGHT;
+  int16_t x1 = (s_pending.origin.x + s_pending.size.w + RECTWIDTH - 1) / RECTWIDTH * RECTWIDTH;
+  int16_t y1 = (s_pending.origin.y + s_pending.size.h + RECTHEIGHT - 1) / RECTHEIGHT * RECTHEIGHT;
+  x0 = x0 < 0 ? 0 : x0;
+  y0 = y0 < 0 ? 0 : y0;
+  x1 = x1 > s_screen.size.w ? s_screen.size.w : x1;
+  y1 = y1 > s_screen.size.h ? s_screen.size.h : y1;
+  s_pending = GRect(x0, y0, x1 - x0, y1 - y0);
+
+  //Shrink the layer to the update region, keeping screen coordinates for drawing
+  layer_set_frame(s_layer, s_pending);
+  layer_set_bounds(s_layer, GRect(-x0, -y0, s_screen.size.w, s_screen.size.h));
+  layer_mark_dirty(s_layer);
+}
+
+#if defined(PROFILE_RENDER)
+void compositor_profile_frame(ProfileSection section){
+  if(s_pending.size.w != 0 && s_pending.size.h != 0){
+    s_frame_section = section;
+  }
+}
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <pebble.h>
+#include "profile.h"
+
+// The whole face is one layer drawing a retained display list of widgets,
+// back to front. Changing a widget queues its screen frame for repaint, and
+// each frame repaints only the queued region. A widget is drawn only if it
+// changed or a widget under it was drawn; the framebuffer keeps everything
+// else from earlier frames.
+
+typedef enum {
+  WIDGET_BACKGROUND,
+  WIDGET_CELLS,
+  NUM_WIDGETS
+} WidgetId;
+
+// Draw a widget at frame. Drawing uses screen coordinates and is clipped to
+// region, the part of the screen being repainted
+typedef void (*WidgetDrawProc)(GContext *ctx, GRect frame, GRect region);
+
+Layer *compositor_create(GRect bounds);
+void compositor_destroy(void);
+
+void compositor_add(WidgetId id, GRect frame, WidgetDrawProc draw);
+// Queue all of a widget, or just rect of it, for the next frame
+void compositor_mark_dirty(WidgetId id);
+void compositor_mark_dirty_rect(WidgetId id, GRect rect);
+
+// Schedule a frame covering everything queued since the last one
+void compositor_flush(void);
+
+#if defined(PROFILE_RENDER)
+// Also time the frame now queued, if any, as section, to charge its drawing
+// to the work that queued it
+void compositor_profile_frame(ProfileSection section);
+#endif
@@ -1,28 +1,74 @@
+// Config page fields and the watch keys they set, as in pixel_grid.h
+var CONFIG_SCHEMA_VERSION = 1;
+var CONFIG_FIELDS = [
+  ['hour_color', 3],
+  ['minute_color', 4],
+  ['second_color', 5],
+  ['temp_scale', 6],
+  ['hide_seconds', 7],
+  ['bt_logo', 8],
+  ['show_animation', 9],
+  ['temp_update', 10],
+  ['square', 11],
+  ['date_format', 12],
+  ['seconds_timeout', 13],
+  ['theme', 15],
+  ['sweep_seconds', 17]
+];
+
+// Every setting fits a byte; null for anything the page did not fill in
+function toByte(value) {
+  if(typeof value === 'boolean') {
+    return value ? 1 : 0;
+  }
+  var number = parseInt(value, 10);
+  return isNaN(number) ? null : number & 0xFF;
+}
+
+// Settings the watch holds, by config page field: what it reported on launch
+// and every push it has acknowledged since
+function readAcked() {
+  try {
+    return JSON.parse(localStorage.getItem('acked_config')) || {};
+  } catch(e) {
+    return {};
+  }
+}
+
 function updateMenu(conf){
   var configData = JSON.parse(conf);
   console.log('Configuration page returned: ' + JSON.stringify(configData));
+  // Handed back to the page next time, to show what was chosen
+  localStorage.setItem('config_page', conf);
 
-  var dict = {};
-  /*if(configData['hide_seconds'] === true) {
-    dict['KEY_HIDE_SECONDS'] = configData['hide_seconds'];
-  }*/
-  dict['isWeather'] = 0;
-  dict['KEY_HOUR_COLOR'] = parseInt(configData['hour_color']);
-  dict['KEY_SECOND_COLOR'] = parseInt(configData['second_color']);
-  dict['KEY_MINUTE_COLOR'] = parseInt(configData['minute_color']);
-  dict['KEY_TEMP_SCALE'] = parseInt(configData['temp_scale']);  
-  dict['KEY_BT_LOGO_TYPE'] = parseInt(configData['bt_logo']);
-  dict['KEY_SHOW_ANIMATION'] = parseInt(configData['show_animation']);
-  dict['KEY_HIDE_SECONDS'] = parseInt(configData['hide_seconds']);
-  dict['KEY_WEATHER_MODE'] = parseInt(configData['temp_update']);
-  dict['KEY_SQUARE_FACE'] = parseInt(configData['square']);
-  dict['KEY_DATE_FORMAT'] = parseInt(configData['date_format']);
-
-  
+  // Only what differs from the last acknowledged push, packed as the schema
+  // version followed by a key and a value byte per setting
+  var acked = readAcked();
+  var packed = [CONFIG_SCHEMA_VERSION];
+  var sent = {};
+  CONFIG_FIELDS.forEach(function(field) {
+    var value = toByte(configData[field[0]]);
+    if(value !== null && acked[field[0]] !== value) {
+      packed.push(field[1], value);
+      sent[field[0]] = value;
+    }
+  });
+
+  if(packed.length === 1) {
+    console.log('Configuration unchanged, nothing to send');
+    return;
+  }
+
+  var dict = {'KEY_CONFIG_PACKED': packed};
 
   // Send to watchapp
   Pebble.sendAppMessage(dict, function() {
-    console.log('Send successful: ' + JSON.stringify(dict));
+    console.log('Send successful: ' + JSON.stringify(sent));
+    var acked = readAcked();
+    for(var name in sent) {
+      acked[name] = sent[name];
+    }
+    localStorage.setItem('acked_config', JSON.stringify(acked));
   }, function() {
     console.log('Send failed!');
   });
@@ -32,11 +78,34 @@ Pebble.addEventListener('ready', function(e) {
     console.log('JavaScript ready.');
 });
 
+// On launch the watch reports every setting it holds, packed like a push.
+// That replaces the acked settings, so a reset or reinstalled watch, or a
+// push it rejected, gets the settings it lacks on the next push
+Pebble.addEventListener('appmessage', function(e) {
+  var packed = e.payload['KEY_CONFIG_PACKED'];
+  if(!packed) {
+    return;
+  }
+  var acked = {};
+  if(packed[0] === CONFIG_SCHEMA_VERSION) {
+    for(var i = 1; i + 1 < packed.length; i += 2) {
+      CONFIG_FIELDS.forEach(function(field) {
+        if(field[1] === packed[i]) {
+          acked[field[0]] = packed[i + 1];
+        }
+      });
+    }
+  }
+  console.log('Watch holds: ' + JSON.stringify(acked));
+  localStorage.setItem('acked_config', JSON.stringify(acked));
+});
+
 Pebble.addEventListener('showConfiguration', function(e) {
-  // Show config page
-  var loc = 'http://phytomine.github.io';
-  console.log('Showing configuration page: ' + loc);
-  Pebble.openURL(loc);  
+  // Show the config page built into the app (tools/config_page.py), with the
+  // options last submitted
+  var saved = localStorage.getItem('config_page') || '{}';
+  console.log('Showing configuration page with: ' + saved);
+  Pebble.openURL(CONFIG_PAGE_URL + '#' + encodeURIComponent(saved));
 });
 
 
@@ -1,9 +1,11 @@
 
 #include "gbitmap_color_palette_manipulator.h"
+#include "profile.h"
 
 #ifdef PBL_COLOR
 
-#define SHOW_APP_LOGS
+//Logs every palette entry touched, far too chatty to leave on outside debugging
+//#define SHOW_APP_LOGS
 
 char* get_gbitmapformat_text(GBitmapFormat format){
 	switch (format) {
@@ -80,6 +82,119 @@ void replace_gbitmap_color(GColor color_to_replace, GColor replace_with_color, G
 
 }
 
+void gcolor_remap_init(GColor lut[GCOLOR_REMAP_SIZE]){
+
+	//Every color maps to itself
+	for(int i = 0; i < GCOLOR_REMAP_SIZE; i++){
+		lut[i].argb = 0xC0 | i;
+	}
+
+}
+
+void gcolor_remap_set(GColor lut[GCOLOR_REMAP_SIZE], GColor from, GColor to){
+
+	lut[from.argb & 0x3F] = to;
+
+}
+
+//Look up the color bits, keeping the pixel's own alpha. Fully transparent
+//pixels are left as they are, whatever their color bits
+static inline uint8_t remap_argb(const GColor *lut, uint8_t argb){
+
+	if((argb & 0xC0) == 0){
+		return argb;
+	}
+	return (argb & 0xC0) | (lut[argb & 0x3F].argb & 0x3F);
+
+}
+
+static void remap_pixels(const GColor *lut, uint8_t *data, int length){
+
+	//Single pixels up to a word boundary
+	while(length > 0 && ((uintptr_t)data & 3) != 0){
+		*data = remap_argb(lut, *data);
+		data++;
+		length--;
+	}
+
+	//Then four pixels per load and store
+	uint32_t *words = (uint32_t *)data;
+	for(; length >= 4; length -= 4, words++){
+
+		uint32_t w = *words;
+
+		//Fully transparent pixels are never seen, leave them be
+		if((w & 0xC0C0C0C0) == 0){
+			continue;
+		}
+
+		*words = (uint32_t)remap_argb(lut, w)
+			| (uint32_t)remap_argb(lut, w >> 8) << 8
+			| (uint32_t)remap_argb(lut, w >> 16) << 16
+			| (uint32_t)remap_argb(lut, w >> 24) << 24;
+
+	}
+
+	//And whatever is left of the row
+	data = (uint8_t *)words;
+	while(length > 0){
+		*data = remap_argb(lut, *data);
+		data++;
+		length--;
+	}
+
+}
+
+void gbitmap_remap_colors(const GColor lut[GCOLOR_REMAP_SIZE], GBitmap **bitmaps, int num_bitmaps){
+
+	for(int b = 0; b < num_bitmaps; b++){
+
+		GBitmap *im = bitmaps[b];
+		GBitmapFormat format = gbitmap_get_format(im);
+		PROFILE_START(start);
+
+		if(format == GBitmapFormat8Bit || format == GBitmapFormat8BitCircular){
+
+			//Remap the pixels themselves, row by row since circular rows differ in length
+			GRect bounds = gbitmap_get_bounds(im);
+			uint32_t num_bytes = 0;
+
+			for(int16_t y = bounds.origin.y; y < bounds.origin.y + bounds.size.h; y++){
+				GBitmapDataRowInfo row = gbitmap_get_data_row_info(im, y);
+				int16_t min_x = row.min_x > bounds.origin.x ? row.min_x : bounds.origin.x;
+				int16_t max_x = row.max_x < bounds.origin.x + bounds.size.w - 1 ? row.max_x : bounds.origin.x + bounds.size.w - 1;
+				if(max_x >= min_x){
+					remap_pixels(lut, row.data + min_x, max_x - min_x + 1);
+					num_bytes += max_x - min_x + 1;
+				}
+			}
+
+			PROFILE_END(PROFILE_REMAP_8BIT, start);
+			PROFILE_COUNT(PROFILE_REMAP_8BIT_BYTES, num_bytes);
+
+		}else{
+
+			//Palettized, so only the palette changes
+			int num_palette_items = get_num_palette_colors(im);
+			GColor *current_palette = gbitmap_get_palette(im);
+
+			for(int i = 0; i < num_palette_items; i++){
+				current_palette[i].argb = remap_argb(lut, current_palette[i].argb);
+
+				#ifdef SHOW_APP_LOGS
+				APP_LOG(APP_LOG_LEVEL_DEBUG, "Palette[%d] = %s (alpha:%d)", i, get_gcolor_text(current_palette[i]),(current_palette[i].argb >>6));
+				#endif
+			}
+
+			PROFILE_END(PROFILE_REMAP_PALETTE, start);
+			PROFILE_COUNT(PROFILE_REMAP_PALETTE_BYTES, num_palette_items);
+
+		}
+
+	}
+
+}
+
 void gbitmap_fill_all_except(GColor color_to_not_change, GColor fill_color, bool fill_gcolorclear, GBitmap *im, BitmapLayer *bml){
 
 	//First determine what the number of colors in the palette
@@ -3,9 +3,22 @@
 #include <pebble.h>
 
 #ifdef PBL_COLOR
+
+//Lookup tables for gbitmap_remap_colors are indexed by the 6 color bits of a GColor
+#define GCOLOR_REMAP_SIZE 64
+
 char* get_gbitmapformat_text(GBitmapFormat format);
 const char* get_gcolor_text(GColor m_color);
+int get_num_palette_colors(GBitmap *b);
 void replace_gbitmap_color(GColor color_to_replace, GColor replace_with_color, GBitmap *im, BitmapLayer *bml);
+//Fill lut with the identity, then set the colors to change
+void gcolor_remap_init(GColor lut[GCOLOR_REMAP_SIZE]);
+void gcolor_remap_set(GColor lut[GCOLOR_REMAP_SIZE], GColor from, GColor to);
+//Recolor every bitmap through lut, keeping alpha: the palette of palettized
+//bitmaps, each pixel of 8 bit ones. The face only loads palettized bitmaps,
+//so the 8 bit path is library code for other users; tools/host/remap_bench.c
+//checks and times it
+void gbitmap_remap_colors(const GColor lut[GCOLOR_REMAP_SIZE], GBitmap **bitmaps, int num_bitmaps);
 void spit_gbitmap_color_palette(GBitmap *im);
 bool gbitmap_color_palette_contains_color(GColor m_color, GBitmap *im);
 void gbitmap_fill_all_except(GColor color_to_not_change, GColor fill_color, bool fill_gcolorclear, GBitmap *im, BitmapLayer *bml);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <pebble.h>
+
+// Pre-rasterized hands, generated at build time by tools/hand_tables.py.
+// Every hand position is a list of spans relative to the clock centre,
+// optionally replayed through an octant transform of another position.
+
+enum {
+  HAND_HOUR = 0,
+  HAND_MINUTE = 1,
+  HAND_SECOND = 2,
+  NUM_HANDS
+};
+
+enum {
+  HAND_FACE_ROUND = 0,
+  HAND_FACE_SQUARE = 1,
+  NUM_HAND_FACES
+};
+
+#define HAND_HOUR_POSITIONS 72
+#define HAND_MINUTE_POSITIONS 60
+// Every second has sub-steps for the sweeping mode; ticking uses the first
+#define HAND_SECOND_SUBSTEPS 4
+#define HAND_SECOND_POSITIONS (60 * HAND_SECOND_SUBSTEPS)
+
+// Transform bits, applied in this order: transpose, then mirror x, then mirror y
+#define HAND_FLIP_X 0x1
+#define HAND_FLIP_Y 0x2
+#define HAND_TRANSPOSE 0x4
+
+// A span is a horizontal run of 1-4 cells of one shade:
+// bits 15-10 x + 32, bits 9-4 y + 32, bits 3-2 length - 1, bits 1-0 shade
+typedef uint16_t HandSpan;
+#define HAND_SPAN(x, y, len, shade) \
+  ((HandSpan)((((x) + 32) << 10) | (((y) + 32) << 4) | (((len) - 1) << 2) | (shade)))
+#define HAND_SPAN_X(s) ((int8_t)((s) >> 10) - 32)
+#define HAND_SPAN_Y(s) ((int8_t)(((s) >> 4) & 0x3F) - 32)
+#define HAND_SPAN_LEN(s) ((((s) >> 2) & 0x3) + 1)
+#define HAND_SPAN_SHADE(s) ((s) & 0x3)
+
+typedef struct {
+  uint16_t first_span;
+  uint8_t num_spans;
+  uint8_t transform;
+} HandPosition;
+
+typedef struct {
+  const HandPosition *positions;
+  const HandSpan *spans;
+} HandTable;
+
+extern const HandTable HAND_TABLES[NUM_HAND_FACES][NUM_HANDS];
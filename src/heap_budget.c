@@ -0,0 +1,96 @@
+#include "heap_budget.h"
+#include "profile.h"
+
+static const char *TAG_NAMES[NUM_HEAP_TAGS] = {
+  "window",
+  "background",
+  "bluetooth",
+  "layers",
+  "app_message"
+};
+
+static int32_t s_current[NUM_HEAP_TAGS];
+static int32_t s_peak[NUM_HEAP_TAGS];
+static size_t s_high_water;
+static size_t s_low_free = SIZE_MAX;
+static bool s_over_budget = false;
+
+// Charge the heap growth since before to tag, negative for a release
+static void charge(HeapTag tag, size_t before){
+  size_t used = heap_bytes_used();
+  s_current[tag] += (int32_t)used - (int32_t)before;
+  if(s_current[tag] > s_peak[tag]){
+    s_peak[tag] = s_current[tag];
+  }
+
+  size_t free_bytes = heap_bytes_free();
+  if(free_bytes < s_low_free){
+    s_low_free = free_bytes;
+  }
+  if(used > s_high_water){
+    s_high_water = used;
+    if(used > HEAP_BUDGET_BYTES && !s_over_budget){
+      s_over_budget = true;
+      APP_LOG(APP_LOG_LEVEL_WARNING, "Heap over budget: %u of %u bytes after %s",
+              (unsigned)used, (unsigned)HEAP_BUDGET_BYTES, TAG_NAMES[tag]);
+    }
+  }
+}
+
+GBitmap *heap_bitmap_create_with_resource(HeapTag tag, uint32_t resource_id){
+  size_t before = heap_bytes_used();
+  GBitmap *bitmap = gbitmap_create_with_resource(resource_id);
+  PROFILE_TALLY(PROFILE_RESOURCE_LOADS);
+  charge(tag, before);
+  return bitmap;
+}
+
+void heap_bitmap_destroy(HeapTag tag, GBitmap *bitmap){
+  size_t before = heap_bytes_used();
+  gbitmap_destroy(bitmap);
+  charge(tag, before);
+}
+
+Layer *heap_layer_create(HeapTag tag, GRect frame){
+  size_t before = heap_bytes_used();
+  Layer *layer = layer_create(frame);
+  charge(tag, before);
+  return layer;
+}
+
+void heap_layer_destroy(HeapTag tag, Layer *layer){
+  size_t before = heap_bytes_used();
+  layer_destroy(layer);
+  charge(tag, before);
+}
+
+Window *heap_window_create(HeapTag tag){
+  size_t before = heap_bytes_used();
+  Window *window = window_create();
+  charge(tag, before);
+  return window;
+}
+
+void heap_window_destroy(HeapTag tag, Window *window){
+  size_t before = heap_bytes_used();
+  window_destroy(window);
+  charge(tag, before);
+}
+
+AppMessageResult heap_app_message_open(HeapTag tag, uint32_t inbox_size, uint32_t outbox_size){
+  size_t before = heap_bytes_used();
+  AppMessageResult result = app_message_open(inbox_size, outbox_size);
+  charge(tag, before);
+  return result;
+}
+
+// CSV like the profiling dump:
+//   heap,tag,current,peak
+//   heap,total,used,high_water,lowest_free,budget
+void heap_budget_report(void){
+  for(int i = 0; i < NUM_HEAP_TAGS; i++){
+    APP_LOG(APP_LOG_LEVEL_INFO, "heap,%s,%ld,%ld", TAG_NAMES[i], (long)s_current[i], (long)s_peak[i]);
+  }
+  APP_LOG(APP_LOG_LEVEL_INFO, "heap,total,%u,%u,%u,%u", (unsigned)heap_bytes_used(),
+          (unsigned)s_high_water, (unsigned)s_low_free, (unsigned)HEAP_BUDGET_BYTES);
+}
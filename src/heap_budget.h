@@ -0,0 +1,34 @@
+#pragma once
+
+#include <pebble.h>
+
+// Heap accounting. Every bitmap, layer, window and the AppMessage buffers
+// are allocated through these wrappers, which charge the change in
+// heap_bytes_used to a subsystem and track the high-water mark against a
+// per-platform budget. Crossing the budget logs a warning once.
+
+#if defined(PBL_ROUND)
+#define HEAP_BUDGET_BYTES (48 * 1024)
+#else
+#define HEAP_BUDGET_BYTES (40 * 1024)
+#endif
+
+typedef enum {
+  HEAP_WINDOW,
+  HEAP_BACKGROUND,
+  HEAP_BLUETOOTH,
+  HEAP_LAYERS,
+  HEAP_APP_MESSAGE,
+  NUM_HEAP_TAGS
+} HeapTag;
+
+GBitmap *heap_bitmap_create_with_resource(HeapTag tag, uint32_t resource_id);
+void heap_bitmap_destroy(HeapTag tag, GBitmap *bitmap);
+Layer *heap_layer_create(HeapTag tag, GRect frame);
+void heap_layer_destroy(HeapTag tag, Layer *layer);
+Window *heap_window_create(HeapTag tag);
+void heap_window_destroy(HeapTag tag, Window *window);
+AppMessageResult heap_app_message_open(HeapTag tag, uint32_t inbox_size, uint32_t outbox_size);
+
+// Log current and peak bytes per subsystem and the overall high-water mark
+void heap_budget_report(void);
@@ -0,0 +1,94 @@
+#include "intro_animation.h"
+#include "profile.h"
+
+typedef struct {
+  uint8_t to;
+  uint16_t start_ms;
+  uint16_t duration_ms;
+} Keyframe;
+
+static Keyframe s_keyframes[NUM_HANDS];
+static uint16_t s_total_ms;
+static uint32_t s_start_ms;
+static IntroFrameHandler s_handler;
+static AppTimer *s_timer;
+
+// Wall clock in ms; only differences are used, so wrapping is harmless
+static uint32_t now_ms(void){
+  time_t seconds;
+  uint16_t ms;
+  time_ms(&seconds, &ms);
+  return (uint32_t)seconds * 1000 + ms;
+}
+
+// Quadratic ease in-out, progress and result in 1/256ths
+static int32_t ease(int32_t p){
+  if(p < 128){
+    return 2 * p * p / 256;
+  }
+  return 256 - 2 * (256 - p) * (256 - p) / 256;
+}
+
+static uint8_t keyframe_position(const Keyframe *k, uint32_t elapsed){
+  if(elapsed <= k->start_ms){
+    return 0;
+  }
+  if(elapsed >= (uint32_t)(k->start_ms + k->duration_ms)){
+    return k->to;
+  }
+  int32_t p = (elapsed - k->start_ms) * 256 / k->duration_ms;
+  return k->to * ease(p) / 256;
+}
+
+static void timer_callback(void *data){
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  uint32_t elapsed = now_ms() - s_start_ms;
+  bool done = elapsed >= s_total_ms;
+
+  uint8_t positions[NUM_HANDS];
+  for(int i = 0; i < NUM_HANDS; i++){
+    positions[i] = keyframe_position(&s_keyframes[i], elapsed);
+  }
+
+  if(done){
+    s_timer = NULL;
+  }else{
+    // Stay on the frame grid; if drawing fell behind, the late frames are dropped
+    uint32_t next = (elapsed / INTRO_FRAME_MS + 1) * INTRO_FRAME_MS;
+    if(next > s_total_ms){
+      next = s_total_ms;
+    }
+    s_timer = app_timer_register(next - elapsed, timer_callback, NULL);
+  }
+  s_handler(positions, done);
+}
+
+void intro_animation_start(const uint8_t targets[NUM_HANDS], IntroFrameHandler handler){
+  intro_animation_cancel();
+
+  uint16_t distance = 0;
+  for(int i = 0; i < NUM_HANDS; i++){
+    distance += targets[i];
+  }
+
+  // Split the budget by distance so every hand sweeps at the same pace
+  uint16_t start = 0;
+  for(int i = 0; i < NUM_HANDS; i++){
+    s_keyframes[i].to = targets[i];
+    s_keyframes[i].start_ms = start;
+    s_keyframes[i].duration_ms = distance ? (uint32_t)INTRO_BUDGET_MS * targets[i] / distance : 0;
+    start += s_keyframes[i].duration_ms;
+  }
+
+  s_total_ms = start;
+  s_handler = handler;
+  s_start_ms = now_ms();
+  timer_callback(NULL);
+}
+
+void intro_animation_cancel(void){
+  if(s_timer != NULL){
+    app_timer_cancel(s_timer);
+    s_timer = NULL;
+  }
+}
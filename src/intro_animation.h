@@ -0,0 +1,18 @@
+#pragma once
+
+#include <pebble.h>
+#include "hand_tables.h"
+
+// Start-up sweep of the hands from 12 o'clock to the current time. The whole
+// sweep is planned up front as one keyframe per hand, run one after the other
+// within INTRO_BUDGET_MS, and every frame is evaluated from elapsed wall time
+// so slow frames are skipped rather than stretching the animation.
+
+#define INTRO_BUDGET_MS 1500
+#define INTRO_FRAME_MS 40
+
+// Called with the hand positions for each frame, done is set on the last one
+typedef void (*IntroFrameHandler)(const uint8_t positions[NUM_HANDS], bool done);
+
+void intro_animation_start(const uint8_t targets[NUM_HANDS], IntroFrameHandler handler);
+void intro_animation_cancel(void);
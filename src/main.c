@@ -1,140 +1,120 @@
 #include <pebble.h>
 #include "pixel_grid.h"
+#include "hand_tables.h"
+#include "intro_animation.h"
+#include "profile.h"
+#include "settings.h"
+#include "outbox.h"
+#include "weather_scheduler.h"
+#include "heap_budget.h"
+#include "theme.h"
+#include "compositor.h"
+#include "state.h"
 #include "gbitmap_color_palette_manipulator.h"
   
 static Window *s_main_window;
-static Layer *s_hands_layer, *s_battery_layer, *s_bt_layer, *s_date_layer, *s_temp_layer;
 
-static BitmapLayer *s_bg_layer;
 static GBitmap *s_bg_bitmap;
 
-static BitmapLayer *s_date_digits_layer[5];
-static GBitmap *s_date_digits_bitmap[5];
-
-static BitmapLayer *s_temp_digits_layer[4];
-static GBitmap *s_temp_digits_bitmap[4];
+static GBitmap *s_bt_img_bitmap;
+static uint32_t s_bt_img_id;
+static GPoint s_bt_origin;
 
-static BitmapLayer *s_day_layer;
-static GBitmap *s_day_bitmap;
+//Everything but the hands is baked into the cell grid's static planes and
+//only rebaked when one of its inputs changes. The plane under the hands
+//holds just the background, which only a new image or theme changes
+static bool s_under_dirty = true;
+static bool s_over_dirty = true;
 
-static BitmapLayer *s_bt_img_layer;
-static GBitmap *s_bt_img_bitmap;
+static Settings s_settings;
 
-static int seconds_color;
-static int minutes_color;
-static int hours_color;
-static int bt_image_type;
-static int temp_scale;
-static int date_format;
-static bool hide_second_hand;
-static bool show_animation;
-static int weather_mode;
-static bool got_weather = false;
-static bool square_face;
-
-static int tap_counter = -1;
+//Hand positions drawn, which the intro animation owns until it is done
 static int hour_pos = 0;
 static int minute_pos = 0;
 static int second_pos = 0;
-static bool hour_ready = false;
-static bool minute_ready = false;
 static bool clock_ready = false;
 
-AppTimer *timer;
-const int delta = 40;
-
-static void fillPixel(Layer *layer, int16_t i, int16_t j, GContext *ctx){
-  int startX = i * (RECTWIDTH);
-  int startY = j * (RECTHEIGHT);
-
-  GRect pixel = GRect(startX, startY, RECTWIDTH-1, RECTHEIGHT-1);
-  graphics_fill_rect(ctx, pixel, 0, GCornerNone);
+//Widget positions in cells. The tap display swaps the date, battery and
+//bluetooth icon for the day name and temperature
+static GPoint s_battery_origin;
+static GPoint s_date_origin;
+static GPoint s_day_origin;
+static GPoint s_temp_origin;
+
+//Tick governor: seconds are only subscribed while a second hand is shown,
+//the tap display and idle timeout run on one-shot timers
+static TimeUnits s_tick_units;
+static bool s_seconds_idle = false;
+//Set when the second hand came back from idle and is not drawn yet
+static bool s_seconds_woken = false;
+static AppTimer *s_tap_timer;
+static AppTimer *s_idle_timer;
+
+//Sweep governor: between ticks the second hand moves in sub-steps, but only
+//while the battery allows it and for a while after the face was woken
+#define SWEEP_STEP_MS (1000 / HAND_SECOND_SUBSTEPS)
+static bool s_sweep_idle = false;
+static AppTimer *s_sweep_timer;
+static AppTimer *s_sweep_idle_timer;
+//What sweeping costs, counted in every build and logged on exit and with the
+//profile dump: the sweep timer's wakeups, and the sub-steps they drew
+static uint32_t s_sweep_wakeups;
+static uint32_t s_sweep_steps;
+
+//Set when the grid gaps were just painted, so every cell goes back over them
+static bool s_background_drawn = false;
+
+#if defined(PROFILE_RENDER)
+//Start of init, for timing the path to the first frame
+static uint32_t s_init_start;
+static bool s_first_frame_drawn = false;
+#endif
+
+static void fillPixel(int16_t i, int16_t j, GColor color){
+  cell_grid_set(i, j, color);
 }
 
-static void draw_shape(Layer *layer, GPoint points[], int n, uint8_t startx, uint8_t starty,  GContext *ctx){
-  for(int i = 0; i < n; i++){
-    fillPixel(layer, startx+points[i].x, starty + points[i].y, ctx);
+//Fill the runs of set bits in one row of a width cell bitmap, leftmost cell
+//in the highest bit, one span per run
+static void draw_row_spans(uint16_t bits, uint8_t width, int16_t x, int16_t y, GColor color){
+  int16_t i = 0;
+  while(i < width){
+    if(!(bits & (1 << (width - 1 - i)))){
+      i++;
+      continue;
+    }
+    int16_t start = i;
+    while(i < width && (bits & (1 << (width - 1 - i)))){
+      i++;
+    }
+    cell_grid_fill_span(x + start, y, i - start, color);
   }
 }
 
-static void setColorShade(float c, uint8_t color, GContext *ctx){ 
-  if(c > HI_COLOR_THRESHOLD){
-    graphics_context_set_fill_color(ctx, (GColor)COLOR_SETS[color][0]);
-  }else if(c > MID_COLOR_THRESHOLD && c <= HI_COLOR_THRESHOLD){
-    graphics_context_set_fill_color(ctx, (GColor)COLOR_SETS[color][1]);    
-  }else if(c > LO_COLOR_THRESHOLD && c <= MID_COLOR_THRESHOLD){
-    graphics_context_set_fill_color(ctx, (GColor)COLOR_SETS[color][2]);
-  }else{
-    graphics_context_set_fill_color(ctx, GColorOxfordBlue);
-  }  
+static void draw_shape(const Shape *shape, int16_t x, int16_t y, GColor color){
+  for(int16_t j = 0; j < SHAPE_HEIGHT; j++){
+    draw_row_spans(shape->rows[j], shape->width, x, y + j, color);
+  }
 }
 
-static void set_container_image(GBitmap **bmp_image, BitmapLayer *bmp_layer, const int resource_id, uint8_t x, uint8_t  y) {
-  GBitmap *old_image = *bmp_image;
-  //*bmp_image = gbitmap_create_with_palette(COLOUR_USER, resource_id);
-  *bmp_image = gbitmap_create_with_resource(resource_id);
-  
-  GPoint origin = { .x = x, .y = y};
-  
-  GRect frame = (GRect) {
-    .origin = origin,
-    .size = gbitmap_get_bounds(*bmp_image).size
-  };
-
-	bitmap_layer_set_bitmap(bmp_layer, *bmp_image);
-  bitmap_layer_set_compositing_mode(bmp_layer, GCompOpSet);
-	layer_set_frame(bitmap_layer_get_layer(bmp_layer), frame);
-  
-  if (old_image != NULL) {
-		gbitmap_destroy(old_image);
-		old_image = NULL;
-  }        
+//Text takes the theme's mark color
+static GColor text_color(){
+  return (GColor){.argb = theme_get()->marks};
 }
 
-static BitmapLayer* create_bitmap_layer(GBitmap *bitmap, Layer *window_layer,
-                                    int16_t x, int16_t y, int16_t w, int16_t h){
-    GRect frame = GRect(x, y, w, h);
-    BitmapLayer* bmp_layer = bitmap_layer_create(frame);
-    bitmap_layer_set_background_color(bmp_layer,GColorBlack);
-    bitmap_layer_set_bitmap(bmp_layer, bitmap);  
-    bitmap_layer_set_compositing_mode(bmp_layer, GCompOpSet);
+//Draw a font glyph with its top left cell at x, y
+static void draw_glyph(uint8_t glyph, int16_t x, int16_t y, GColor color){
+  const Glyph *g = &GLYPHS[glyph];
+  GColor backing = (GColor){.argb = theme_get()->cell};
   
-    layer_add_child(window_layer, bitmap_layer_get_layer(bmp_layer));  
-    return bmp_layer;
-}
-
-static void destroy_bitmap_layer( BitmapLayer *layer, GBitmap *bitmap){
-    layer_remove_from_parent(bitmap_layer_get_layer(layer));  
-    bitmap_layer_destroy(layer);
-    if (bitmap != NULL){ 
-      gbitmap_destroy(bitmap);
+  for(int16_t j = 0; j < GLYPH_HEIGHT; j++){
+    draw_row_spans(g->rows[j], g->width, x, y + j, color);
+    if(g->backed){
+      draw_row_spans(~g->rows[j], g->width, x, y + j, backing);
     }
+  }
 }
 
-static void plot(Layer *layer, uint8_t x, uint8_t y, float c, uint8_t colorset, GContext *ctx){
-  setColorShade(c, colorset, ctx);  
-  
-  if(c > LO_COLOR_THRESHOLD){
-    fillPixel(layer, x, y, ctx);
-  }  
-}
-
-// integer part of x
-static uint8_t ipart(float x){
-    return (uint8_t) x;
-}
-
-// fractional part of x
-static float fpart(float x){
-    return x - (int)x;
-}
-
-
-static float rfpart(float x){
-    return 1.0 - fpart(x);
-}
-
-
 static void swap(uint8_t *i, uint8_t *j) {
    int t = *i;
    *i = *j;
@@ -142,405 +122,705 @@ static void swap(uint8_t *i, uint8_t *j) {
 }
 
 
-static void drawAliasLine(Layer *layer, uint8_t x0, uint8_t y0,uint8_t x1,uint8_t y1, uint8_t colorset, bool thick, GContext *ctx){
-    bool steep = abs(y1 - y0) > abs(x1 - x0);
+//Replay a pre-rasterized hand position into the cell grid
+static void draw_hand(uint8_t hand, uint8_t pos, GPoint center, uint8_t colorset){
+  uint8_t face = HAND_FACE_ROUND;
+  #if defined(PBL_RECT)
+  if(s_settings.square_face){
+    face = HAND_FACE_SQUARE;
+  }
+  #endif
+  
+  const HandTable *table = &HAND_TABLES[face][hand];
+  const HandPosition *position = &table->positions[pos];
+  const HandSpan *span = &table->spans[position->first_span];
+  
+  for(int i = 0; i < position->num_spans; i++, span++){
+    GColor color = (GColor)COLOR_SETS[colorset][HAND_SPAN_SHADE(*span)];
+    int16_t x = HAND_SPAN_X(*span);
+    int16_t y = HAND_SPAN_Y(*span);
+    int16_t len = HAND_SPAN_LEN(*span);
     
-    if(steep){
-        swap(&x0, &y0);
-        swap(&x1, &y1);
-    }
-    if(x0 > x1){
-        swap(&x0, &x1);
-        swap(&y0, &y1);
+    //Untransposed spans stay rows, so they fill in one go
+    if(!(position->transform & HAND_TRANSPOSE)){
+      if(position->transform & HAND_FLIP_X){
+        x = -(x + len - 1);
+      }
+      if(position->transform & HAND_FLIP_Y){
+        y = -y;
+      }
+      cell_grid_fill_span(center.x + x, center.y + y, len, color);
+      continue;
     }
     
-    int16_t dx = x1 - x0;
-    int16_t dy = y1 - y0;
-    float gradient = (float) dy / (float) dx;
-    float intery = y0; // first y-intersection for the main loop    
-
-    for (uint8_t x = x0; x <= x1; x++){
-        if(steep){
-            if(thick){
-              plot(layer, ipart(intery)-1, x, rfpart(intery)/2, colorset, ctx);
-              plot(layer, ipart(intery), x, 1, colorset, ctx);     
-            }else{
-              plot(layer, ipart(intery), x, rfpart(intery), colorset, ctx);                   
-            }
-            plot(layer, ipart(intery)+1, x,  fpart(intery), colorset, ctx);
-        }else{
-            if(thick){
-              plot(layer, x, ipart(intery)-1, rfpart(intery)/2, colorset, ctx);
-              plot(layer, x, ipart(intery), 1, colorset, ctx);     
-            }else{
-              plot(layer, x, ipart(intery), rfpart(intery), colorset, ctx);                   
-            }                 
-            plot(layer, x, ipart(intery)+1, fpart(intery), colorset, ctx);
-        }
-        intery = intery + gradient;
+    for(int16_t k = x; k < x + len; k++){
+      int16_t cx = y;
+      int16_t cy = k;
+      if(position->transform & HAND_FLIP_X){
+        cx = -cx;
+      }
+      if(position->transform & HAND_FLIP_Y){
+        cy = -cy;
+      }
+      fillPixel(center.x + cx, center.y + cy, color);
     }
+  }
+}
+
+
+static void draw_battery(GPoint origin) {  
+  const State *state = state_get();
   
-    //Make sure endpoint gets drawn
-    if (steep){
-        plot(layer, y1, x1, 1, colorset, ctx);
-    }else{
-        plot(layer, x1, y1, 1, colorset, ctx);
-    }  
+  uint8_t charge = state->charge;
+  GColor charge_color;
+  GColor case_color = GColorWhite;  
+
+  if(state->plugged){
+    case_color = GColorGreen;
+  }
+  
+  if(charge >= BAT_WARN_LEVEL){
+    charge_color = GColorGreen;
+  }
+  else if(charge > BAT_ALERT_LEVEL && charge <BAT_WARN_LEVEL){
+    charge_color = GColorYellow;
+  }
+  else{
+    charge_color = GColorRed;
+  }    
+  
+  draw_shape(&BAT_CASE_SHAPE, origin.x, origin.y, case_color);
+
+  //battery fill, a cell per tenth
+  cell_grid_fill_span(origin.x + 1, origin.y + 1, charge/10, charge_color);
+  
+  //Charge icon
+  if(state->charging){
+    draw_shape(&CHARGE_SHAPE, origin.x + 3, origin.y, GColorYellow);
+  }
 }
 
+static void draw_date(GPoint origin){
+  uint8_t month = state_get()->month;
+  uint8_t day = state_get()->day;
 
-static GPoint createHand(int32_t angle, int16_t length, int x, int y){
-  int32_t sin = sin_lookup(angle);
-  int32_t cos = cos_lookup(angle);
-  int32_t corr = TRIG_MAX_RATIO;
+  GColor color = text_color();
+
+  if(s_settings.date_format == MMDD_DATE_FORMAT){
+    swap(&month,&day);
+  }
   
-  //square face correction
-  #if defined(PBL_RECT)
-  if(square_face){
-    corr = abs(cos);
-    if((float)corr/0.707 < TRIG_MAX_RATIO){
-      corr = abs(sin);
-    }
+  draw_glyph(GLYPH_DIGIT0 + day/10, origin.x, origin.y, color);
+  draw_glyph(GLYPH_DIGIT0 + day%10, origin.x + 4, origin.y, color);
+  draw_glyph(GLYPH_SLASH, origin.x + 8, origin.y, color);
+  draw_glyph(GLYPH_DIGIT0 + month/10, origin.x + 11, origin.y, color);
+  draw_glyph(GLYPH_DIGIT0 + month%10, origin.x + 15, origin.y, color);
+}
+
+static void draw_temperature(GPoint origin){
+  if(!state_get()->has_temperature){
+    return;
+  }
+  
+  //Converted to the configured scale only when drawn
+  int temperature = state_get()->temperature;
+  if(s_settings.temp_scale == FAHRENHEIT_SCALE){
+    temperature = temperature * 9/5 + 32;
+  }
+  bool neg_temp = false;
+  if(temperature < 0){
+    temperature = -temperature;
+    neg_temp = true;
+  }
+  
+  int t1 = temperature/100;
+  int t2 = (temperature%100)/10;
+  int t3 = temperature%10;
+  
+  GColor color = text_color();
+  int16_t x = origin.x;
+  int16_t y = origin.y;
+  #if defined(PBL_ROUND)
+  y = y + 1;
+  if(t1 == 0 && !neg_temp){  
+    x = x + 1;
   }
   #endif
   
-  GPoint hand = {
-    .x = (int16_t)((sin * length)/corr) + x,
-    .y = (int16_t)((-cos * length)/corr) + y,
-  };
-  return hand;
+  if(t1 != 0){
+    draw_glyph(GLYPH_DIGIT0 + t1, x, y, color);
+    x += 4;
+  } else if(neg_temp){
+    draw_glyph(GLYPH_NEGATIVE, x, y, color);
+    x += 4;
+  }
+  if(t2 != 0 || t1 != 0){
+    draw_glyph(GLYPH_DIGIT0 + t2, x, y, color);
+    x += 4;
+  }
+  else{
+    x += 2;
+  }
+  draw_glyph(GLYPH_DIGIT0 + t3, x, y, color);
+  x += 4;
+  draw_glyph(GLYPH_DEGREE, x, y, color);
 }
 
+static bool seconds_shown(){
+  return !s_settings.hide_second_hand && !s_seconds_idle;
+}
 
-static void hands_update_proc(Layer *layer, GContext *ctx) {
-  GPoint center = { .x = WIDTH/2, .y = WIDTH/2-1};
-  int16_t second_hand_length = (WIDTH / 2)*5/6;
-  int16_t minute_hand_length = (WIDTH / 2)*2/3;
-  int16_t hour_hand_length = (WIDTH / 2)/2;
-  
+static bool sweeping(){
+  const State *state = state_get();
+  return s_settings.sweep_seconds && seconds_shown() && !s_sweep_idle &&
+         (state->plugged || state->charge >= SWEEP_MIN_CHARGE);
+}
+
+//Bake whichever planes are out of date: the background under the hands, or
+//the PM marker, bluetooth icon, battery and text over them
+static void bake_static(){
+  PROFILE_START(start);
+  const State *state = state_get();
   uint8_t pm_x = WIDTH - 10;
   uint8_t pm_y = WIDTH - 2;
   
   #if defined(PBL_ROUND)  
   pm_y = WIDTH/2 + 18;
   pm_x = WIDTH/2 - 4;  
-  center.y = center.y + 1;
   #endif
-  time_t now = time(NULL);
-  struct tm *t = localtime(&now);
-  
-  int hour = (((t->tm_hour) % 12) * 6) + (t->tm_min / 10);
-  
-  //Start-up animation.
-  //Flags indicate when each hand is done
-  if(show_animation && !clock_ready){
-    if(!hour_ready){
-      hour_pos+= 2;
-      if(hour_pos >= hour){
-        hour_pos = hour;
-        hour_ready = true;
-      }
-    }else if(!minute_ready){
-      minute_pos+= 2;
-      if(minute_pos >= t->tm_min){
-        minute_pos = t->tm_min;
-        minute_ready = true;
-      }
-    }else{
-      second_pos+= 2;
-      if(second_pos >= t->tm_sec){
-        second_pos = t->tm_sec;    
-        clock_ready = true;
+  
+  if(s_under_dirty){
+    cell_grid_bake_begin(CELL_PLANE_UNDER);
+    cell_grid_bake_bitmap(s_bg_bitmap, 0, 0);
+  }
+  
+  if(s_over_dirty){
+    cell_grid_bake_begin(CELL_PLANE_OVER);
+    if(state->pm){  
+      draw_shape(&PM_SHAPE, pm_x, pm_y, GColorYellow);  
+    }    
+    
+    if(state->tap_display){
+      draw_glyph(GLYPH_SUN + state->weekday, s_day_origin.x, s_day_origin.y, text_color());
+      draw_temperature(s_temp_origin);
+    } else {
+      if(state->bt_connected && s_bt_img_bitmap != NULL){
+        cell_grid_bake_bitmap(s_bt_img_bitmap, s_bt_origin.x, s_bt_origin.y);
       }
+      draw_battery(s_battery_origin);
+      draw_date(s_date_origin);
     }
-  }else{
-    hour_pos = hour;
-    second_pos = t->tm_sec;    
-    minute_pos = t->tm_min;
   }
+  cell_grid_bake_end();
   
-  int32_t second_angle = TRIG_MAX_ANGLE * second_pos / 60;
-  int32_t minute_angle = TRIG_MAX_ANGLE * minute_pos / 60;
-  int32_t hour_angle = TRIG_MAX_ANGLE * hour_pos / 72;
+  s_under_dirty = false;
+  s_over_dirty = false;
+  PROFILE_END(PROFILE_BAKE, start);
+}
+
+static void invalidate_under(){
+  s_under_dirty = true;
+}
+
+static void invalidate_over(){
+  s_over_dirty = true;
+}
+
+//State the plane over the hands shows: the PM marker and settings always, the rest
+//depending on the tap display
+static uint32_t baked_state(){
+  uint32_t flags = STATE_PM | STATE_TAP_DISPLAY | STATE_SETTINGS;
+  if(state_get()->tap_display){
+    return flags | STATE_WEEKDAY | STATE_TEMPERATURE;
+  }
+  return flags | STATE_DATE | STATE_BATTERY | STATE_BLUETOOTH;
+}
+
+//Rasterize the hands over the baked planes and schedule a redraw of just the
+//cells that changed since the last frame
+static void render_cells() {
+  PROFILE_START(start);
+  GPoint center = { .x = WIDTH/2, .y = WIDTH/2-1};
   
-  //Create hands
-  GPoint second_hand = createHand(second_angle,second_hand_length, center.x, center.y);
-  GPoint minute_hand = createHand(minute_angle,minute_hand_length, center.x, center.y);
-  GPoint hour_hand = createHand(hour_angle,hour_hand_length, center.x, center.y);
+  #if defined(PBL_ROUND)  
+  center.y = center.y + 1;
+  #endif
+  if(s_under_dirty || s_over_dirty){
+    bake_static();
+  }
+  s_seconds_woken = false;
+  
+  //The intro animation owns the hand positions until it is done
+  if(!s_settings.show_animation || clock_ready){
+    hour_pos = state_get()->hour_pos;
+    second_pos = state_get()->second_pos;    
+    minute_pos = state_get()->minute_pos;
+  }
+  
+  cell_grid_clear();
   
   // Draw hand
-  drawAliasLine(layer, center.x, center.y, hour_hand.x, hour_hand.y, hours_color, true, ctx);
-  drawAliasLine(layer, center.x, center.y, minute_hand.x, minute_hand.y, minutes_color, true, ctx); 
-  if(!hide_second_hand){
-    drawAliasLine(layer, center.x, center.y, second_hand.x, second_hand.y, seconds_color, false, ctx); 
+  draw_hand(HAND_HOUR, hour_pos, center, s_settings.hours_color);
+  draw_hand(HAND_MINUTE, minute_pos, center, s_settings.minutes_color); 
+  if(seconds_shown()){
+    draw_hand(HAND_SECOND, second_pos, center, s_settings.seconds_color); 
   }
   
-  // Draw PM
-  if(t->tm_hour >= 12){  
-    graphics_context_set_fill_color(ctx, GColorYellow); 
-    draw_shape(layer, PM_POINTS.points, PM_POINTS.num_points, pm_x, pm_y, ctx);  
-  }    
+  cell_grid_overlay();
+  GRect dirty = cell_grid_commit();
+  PROFILE_END(PROFILE_RENDER_CELLS, start);
   
+  //Repaint just the cells that changed, along with anything else queued
+  compositor_mark_dirty_rect(WIDGET_CELLS, GRect(dirty.origin.x * RECTWIDTH, dirty.origin.y * RECTHEIGHT,
+                                                 dirty.size.w * RECTWIDTH, dirty.size.h * RECTHEIGHT));
+  compositor_flush();
 }
 
-void timer_callback(void *data) {
-    if(!clock_ready){
-      layer_mark_dirty(s_hands_layer);
- 
-      //Register next execution
-      timer = app_timer_register(delta, (AppTimerCallback) timer_callback, NULL);
-    }
+//Apply the state changes since the last frame: rebake if the planes show any
+//of them, and draw a frame only if anything visible changed
+static void update_display() {
+  uint32_t changes = state_take_changes();
+  if(changes & baked_state()){
+    invalidate_over();
+  }
+  if(s_under_dirty || s_over_dirty || s_seconds_woken || (changes & (STATE_HANDS | STATE_SETTINGS))){
+    render_cells();
+  }
 }
 
-static void battery_update_proc(Layer *layer, GContext *ctx) {  
-  BatteryChargeState state = battery_state_service_peek();
-  
-  uint8_t charge = state.charge_percent;
-  GColor charge_color;
-  GColor case_color = GColorWhite;  
+static void request_full_redraw() {
+  compositor_mark_dirty(WIDGET_BACKGROUND);
+  render_cells();
+}
 
-  if(state.is_plugged){
-    case_color = GColorGreen;
+//The background image is baked into the cells, which leaves the black grid
+//gaps. Nothing else draws over them, so they are only painted on a full redraw
+static void draw_background(GContext *ctx, GRect frame, GRect region){
+  graphics_context_set_fill_color(ctx, GColorBlack);
+  graphics_fill_rect(ctx, frame, 0, GCornerNone);
+  s_background_drawn = true;
+  
+  #if defined(PROFILE_RENDER)
+  if(!s_first_frame_drawn){
+    profile_record(PROFILE_FIRST_FRAME, s_init_start);
+    s_first_frame_drawn = true;
   }
-  
-  if(charge >= BAT_WARN_LEVEL){
-    charge_color = GColorGreen;
+  #endif
+}
+
+//Unless the gaps were repainted under them, only the cells that changed are
+//painted: a second hand step touches just the cells it leaves and enters
+static void draw_cells(GContext *ctx, GRect frame, GRect region){
+  cell_grid_blit(ctx, GRect(region.origin.x / RECTWIDTH, region.origin.y / RECTHEIGHT,
+                            region.size.w / RECTWIDTH, region.size.h / RECTHEIGHT), !s_background_drawn);
+  s_background_drawn = false;
+}
+
+static void intro_frame(const uint8_t positions[NUM_HANDS], bool done){
+  hour_pos = positions[HAND_HOUR];
+  minute_pos = positions[HAND_MINUTE];
+  second_pos = positions[HAND_SECOND] * HAND_SECOND_SUBSTEPS;
+  clock_ready = done;
+  render_cells();
+}
+
+static void start_intro(){
+  const State *state = state_get();
+  
+  uint8_t targets[NUM_HANDS];
+  targets[HAND_HOUR] = state->hour_pos;
+  targets[HAND_MINUTE] = state->minute_pos;
+  //Land the second hand where the clock will be when the sweep ends. It
+  //moves in whole seconds, at the same pace as the other hands
+  targets[HAND_SECOND] = 0;
+  if(seconds_shown()){
+    targets[HAND_SECOND] = (state->second_pos / HAND_SECOND_SUBSTEPS + INTRO_BUDGET_MS / 1000) % 60;
   }
-  else if(charge > BAT_ALERT_LEVEL && charge <BAT_WARN_LEVEL){
-    charge_color = GColorYellow;
+  intro_animation_start(targets, intro_frame);
+}
+
+
+//Load the icon for the configured style, once; it stays loaded while
+//disconnected and is simply not baked
+static void load_bt_img() {  
+  uint32_t bt_id = RESOURCE_ID_BT1;
+  if(s_settings.bt_image_type == BT_IMAGE_LARGE){
+    bt_id = RESOURCE_ID_BT2;
   }
-  else{
-    charge_color = GColorRed;
-  }    
-  
-  graphics_context_set_fill_color(ctx, case_color);  
-  draw_shape(layer, BAT_CASE_POINTS.points, BAT_CASE_POINTS.num_points, 0, 0, ctx);             
+  if(s_bt_img_bitmap != NULL){
+    if(bt_id == s_bt_img_id){
+      return;
+    }
+    theme_bitmap_destroy(HEAP_BLUETOOTH, s_bt_img_bitmap);
+  }
+  s_bt_img_bitmap = theme_bitmap_create(HEAP_BLUETOOTH, bt_id);
+  s_bt_img_id = bt_id;
+  invalidate_over();
+}
 
-  graphics_context_set_fill_color(ctx, charge_color);         
-  for(int i = 0; i < charge/10; i++ ){    
-    //battery fill
-    fillPixel(layer, i + 1, 1, ctx);    
+static void load_background(){
+  if(s_bg_bitmap != NULL){
+    theme_bitmap_destroy(HEAP_BACKGROUND, s_bg_bitmap);
   }
-  
-  //Charge icon
-  if(state.is_charging){
-    graphics_context_set_fill_color(ctx, GColorYellow); 
-    draw_shape(layer, CHARGE_POINTS.points, CHARGE_POINTS.num_points, 3, 0, ctx);           
+  #if defined(PBL_RECT)
+  if(s_settings.square_face){
+    s_bg_bitmap = theme_bitmap_create(HEAP_BACKGROUND, RESOURCE_ID_BG_SQUARE);  
+  }
+  else{
+    s_bg_bitmap = theme_bitmap_create(HEAP_BACKGROUND, RESOURCE_ID_BG_ROUND);  
   }
+  #elif defined(PBL_ROUND)
+  s_bg_bitmap = theme_bitmap_create(HEAP_BACKGROUND, RESOURCE_ID_BG_ROUND);  
+  #endif
+  invalidate_under();
 }
 
 
-static void update_bt_img(bool connected) {  
+
+static void show_tap_display(bool show){
+  state_set_tap_display(show);
+  update_display();
+}
+
+
+
+static void bt_handler(bool connected) {
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  weather_scheduler_connection(connected);
   if(!connected){
     vibes_short_pulse();
-    layer_set_hidden(bitmap_layer_get_layer(s_bt_img_layer), true);      
-  }else{
-    int bt_id = RESOURCE_ID_BT1;
-    if(bt_image_type == BT_IMAGE_LARGE){
-      bt_id = RESOURCE_ID_BT2;
-    }
-    set_container_image(&s_bt_img_bitmap, s_bt_img_layer, bt_id, 0, 0);      
-    layer_set_hidden(bitmap_layer_get_layer(s_bt_img_layer), false);      
   }
+  state_set_bluetooth(connected);
+  update_display();
 }
 
-static void update_date(){
-  uint8_t x = 0;//(WIDTH-19)*RECTWIDTH;
-  uint8_t y = 0;//;(WIDTH + 2)*RECTWIDTH;  
-  uint8_t day_x = 6*RECTWIDTH;
-  uint8_t day_y = 0;
-  #if defined(PBL_ROUND)
-  day_x = 3*RECTWIDTH;
-  #endif  
-  
-  GPoint origin = layer_get_frame(s_date_layer).origin;
-  
-  time_t now = time(NULL);
-  struct tm *t = localtime(&now);
-  uint8_t month = t->tm_mon + 1;
-  uint8_t day = t->tm_mday;
-  uint8_t wday = t->tm_wday;
+static void battery_handler(BatteryChargeState new_state) {
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  state_set_battery(new_state);
+  update_display();
+}
 
-  if(date_format == MMDD_DATE_FORMAT){
-    swap(&month,&day);
-  }
 
-  uint8_t m1 = (month)/10;
-  uint8_t m2 = (month)%10;
-  uint8_t d1 = day/10;
-  uint8_t d2 = day%10;
-  
-	set_container_image(&s_date_digits_bitmap[0], s_date_digits_layer[0], DIGIT_IMAGE_RESOURCE_IDS[d1], x, y);  
-	set_container_image(&s_date_digits_bitmap[1], s_date_digits_layer[1], DIGIT_IMAGE_RESOURCE_IDS[d2], x + 4*RECTWIDTH, y);  
-	set_container_image(&s_date_digits_bitmap[2], s_date_digits_layer[2], RESOURCE_ID_SLASH, x + 8*RECTWIDTH, y);  
-	set_container_image(&s_date_digits_bitmap[3], s_date_digits_layer[3], DIGIT_IMAGE_RESOURCE_IDS[m1], x + 11*RECTWIDTH, y);  
-	set_container_image(&s_date_digits_bitmap[4], s_date_digits_layer[4], DIGIT_IMAGE_RESOURCE_IDS[m2], x + 15*RECTWIDTH, y);    
+//Refetch once the last reading is older than the polling period of the
+//weather mode: 30 minutes for mode 1, an hour otherwise
+static void refresh_weather_if_stale(){
+  if(s_settings.weather_mode == 0){
+    return;
+  }
+  uint32_t max_age = (s_settings.weather_mode == 1 ? 30 : 60) * 60;
+  if(weather_scheduler_is_stale(max_age)){
+    weather_scheduler_request();
+  }
+}
 
+static void sweep_timer_callback(void *data);
 
-	set_container_image(&s_day_bitmap, s_day_layer, DAY_NAME_IMAGE_RESOURCE_IDS[wday], origin.x+day_x, origin.y + day_y);    
+//Queue the next sub-step within the current second; the tick starts every
+//second from its first sub-step
+static void schedule_sweep(){
+  if(s_sweep_timer != NULL || !clock_ready || !sweeping()){
+    return;
+  }
+  time_t seconds;
+  uint16_t ms;
+  time_ms(&seconds, &ms);
+  uint16_t next = (ms / SWEEP_STEP_MS + 1) * SWEEP_STEP_MS;
+  if(next < 1000){
+    s_sweep_timer = app_timer_register(next - ms, sweep_timer_callback, NULL);
+  }
 }
 
+static void sweep_timer_callback(void *data){
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  s_sweep_wakeups++;
+  s_sweep_timer = NULL;
+  if(!clock_ready || !sweeping()){
+    return;
+  }
+  PROFILE_START(start);
+  time_t seconds;
+  uint16_t ms;
+  time_ms(&seconds, &ms);
+  //A late timer can land in the next second before its tick; never step back
+  uint8_t step = ms / SWEEP_STEP_MS;
+  if(step > state_get()->second_pos % HAND_SECOND_SUBSTEPS){
+    state_set_second_step(step);
+    update_display();
+    s_sweep_steps++;
+    //The frame is drawn after this returns; count it as sweep time too
+    #if defined(PROFILE_RENDER)
+    compositor_profile_frame(PROFILE_SWEEP);
+    #endif
+  }
+  schedule_sweep();
+  PROFILE_END(PROFILE_SWEEP, start);
+}
 
-static void show_tap_display(bool show){
-  //swap visible layers
-  layer_set_hidden(bitmap_layer_get_layer(s_day_layer), !show);
-  layer_set_hidden(s_date_layer, show); 
-  
-  layer_set_hidden(s_temp_layer, !show);     
-  layer_set_hidden(s_bt_layer, show);  
-  layer_set_hidden(s_battery_layer, show);
+//One CSV line, next to the profile dump's: sweep,wakeups,steps. Release
+//builds only log it when the phone asks for the dump
+static void log_sweep_counts(){
+  APP_LOG(APP_LOG_LEVEL_INFO, "sweep,%lu,%lu", (unsigned long)s_sweep_wakeups, (unsigned long)s_sweep_steps);
 }
 
-static void request_temperature(){
-  // Begin dictionary
-  DictionaryIterator *iter;
-  app_message_outbox_begin(&iter);
+static void sweep_idle_timer_callback(void *data){
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  s_sweep_idle_timer = NULL;
+  s_sweep_idle = true;
+}
 
-  // Add a key-value pair
-  dict_write_uint8(iter, 0, 0);
+static void handle_tick(struct tm *t, TimeUnits units_changed) {
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  state_set_time(t);
+  if(clock_ready){
+    update_display();
+    schedule_sweep();
+  }
+  
+  // Modes 1 and 2 poll while running, mode 3 only checks at start
+  if(s_settings.weather_mode < 3 && (units_changed & MINUTE_UNIT)) {
+    refresh_weather_if_stale();
+  }  
+}
 
-  // Send the message!
-  app_message_outbox_send();
+static void update_tick_rate(){
+  TimeUnits units = seconds_shown() ? SECOND_UNIT : MINUTE_UNIT;
+  if(units != s_tick_units){
+    tick_timer_service_subscribe(units, handle_tick);
+    s_tick_units = units;
+  }
 }
 
+static void idle_timer_callback(void *data){
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  s_idle_timer = NULL;
+  s_seconds_idle = true;
+  update_tick_rate();
+  render_cells();
+}
 
-static void bt_handler(bool connected) {
-  update_bt_img(connected);
+//Bring the second hand back, sweeping if enabled, and restart the idle
+//countdowns; the next update_display draws it
+static void wake_seconds(){
+  s_seconds_woken = s_seconds_woken || s_seconds_idle;
+  s_seconds_idle = false;
+  if(s_settings.seconds_timeout > 0){
+    uint32_t timeout_ms = s_settings.seconds_timeout * 60 * 1000;
+    if(s_idle_timer == NULL || !app_timer_reschedule(s_idle_timer, timeout_ms)){
+      s_idle_timer = app_timer_register(timeout_ms, idle_timer_callback, NULL);
+    }
+  }else if(s_idle_timer != NULL){
+    app_timer_cancel(s_idle_timer);
+    s_idle_timer = NULL;
+  }
+  
+  s_sweep_idle = false;
+  if(s_settings.sweep_seconds){
+    if(s_sweep_idle_timer == NULL || !app_timer_reschedule(s_sweep_idle_timer, SWEEP_IDLE_MS)){
+      s_sweep_idle_timer = app_timer_register(SWEEP_IDLE_MS, sweep_idle_timer_callback, NULL);
+    }
+  }else if(s_sweep_idle_timer != NULL){
+    app_timer_cancel(s_sweep_idle_timer);
+    s_sweep_idle_timer = NULL;
+  }
+  update_tick_rate();
+  schedule_sweep();
 }
 
-static void battery_handler(BatteryChargeState new_state) {
-  layer_mark_dirty(s_battery_layer);
+static void tap_timer_callback(void *data){
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  s_tap_timer = NULL;
+  show_tap_display(false);
 }
 
 static void tap_handler(AccelAxisType axis, int32_t direction) {
+  PROFILE_TALLY(PROFILE_WAKEUPS);
   /*if (direction > 0){
-    seconds_color ++;
+    s_settings.seconds_color ++;
   }else{
-    seconds_color --;
+    s_settings.seconds_color --;
   }
-  seconds_color = (seconds_color + NUM_COLOR)%NUM_COLOR;  
+  s_settings.seconds_color = (s_settings.seconds_color + NUM_COLOR)%NUM_COLOR;  
 */
   
-  tap_counter = TAP_DURATION_MED;
+  //Tapping again while the tap display is up dumps the render timings
+  if(s_tap_timer != NULL){
+    PROFILE_DUMP();
+    #if defined(PROFILE_RENDER)
+    log_sweep_counts();
+    #endif
+  }
+  
+  uint32_t duration_ms = TAP_DURATION_MED * 1000;
+  if(s_tap_timer == NULL || !app_timer_reschedule(s_tap_timer, duration_ms)){
+    s_tap_timer = app_timer_register(duration_ms, tap_timer_callback, NULL);
+  }
+  //Wake first, so the frame below has the second hand back even when the
+  //tap display is already up
+  wake_seconds();
   show_tap_display(true);
-  layer_mark_dirty(s_hands_layer);   
 }
 
-static void handle_second_tick(struct tm *t, TimeUnits units_changed) {
-  if(clock_ready){
-    if((!hide_second_hand && (units_changed & SECOND_UNIT)) || (units_changed & MINUTE_UNIT)){
-        layer_mark_dirty(s_hands_layer);
+//Set one config key on the staged settings
+static void stage_config_value(Settings *staged, uint8_t key, uint8_t value){
+  switch(key) {
+  case KEY_HIDE_SECONDS:
+    staged->hide_second_hand = value;
+    break;
+  case KEY_BT_LOGO_TYPE:
+    if(value){
+      staged->bt_image_type = BT_IMAGE_LARGE;
+    }else{
+      staged->bt_image_type = BT_IMAGE_SMALL;        
     }
+    break;      
+  case KEY_TEMP_SCALE:
+    staged->temp_scale = value;
+    break;      
+  case KEY_SHOW_ANIMATION:
+    staged->show_animation = value;
+    break;
+  case KEY_HOUR_COLOR:
+    staged->hours_color = value;
+    break;
+  case KEY_MINUTE_COLOR:
+    staged->minutes_color = value;
+    break;
+  case KEY_SECOND_COLOR:
+    staged->seconds_color = value;
+    break;     
+  case KEY_WEATHER_MODE:
+    staged->weather_mode = value;              
+    break;  
+  case KEY_DATE_FORMAT:
+    staged->date_format = value;
+    break;  
+  case KEY_SECONDS_TIMEOUT:
+    staged->seconds_timeout = value;
+    break;
+  case KEY_SQUARE_FACE:
+    staged->square_face = value;      
+    break;        
+  case KEY_THEME:
+    staged->theme = value;
+    break;
+  case KEY_SWEEP_SECONDS:
+    staged->sweep_seconds = value;
+    break;
+  default:
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Key %d not recognized!", (int)key);
+    break;
   }
-  if(units_changed & DAY_UNIT){
-      update_date();
+}
+
+//Every key the phone can set, in the order the watch reports them
+static const uint8_t CONFIG_KEYS[] = {
+  KEY_HOUR_COLOR, KEY_MINUTE_COLOR, KEY_SECOND_COLOR, KEY_TEMP_SCALE, KEY_HIDE_SECONDS,
+  KEY_BT_LOGO_TYPE, KEY_SHOW_ANIMATION, KEY_WEATHER_MODE, KEY_SQUARE_FACE, KEY_DATE_FORMAT,
+  KEY_SECONDS_TIMEOUT, KEY_THEME, KEY_SWEEP_SECONDS
+};
+
+//The config byte the phone would send for one key, the reverse of
+//stage_config_value
+static uint8_t config_value(const Settings *settings, uint8_t key){
+  switch(key) {
+  case KEY_HIDE_SECONDS:
+    return settings->hide_second_hand;
+  case KEY_BT_LOGO_TYPE:
+    return settings->bt_image_type == BT_IMAGE_LARGE;
+  case KEY_TEMP_SCALE:
+    return settings->temp_scale;
+  case KEY_SHOW_ANIMATION:
+    return settings->show_animation;
+  case KEY_HOUR_COLOR:
+    return settings->hours_color;
+  case KEY_MINUTE_COLOR:
+    return settings->minutes_color;
+  case KEY_SECOND_COLOR:
+    return settings->seconds_color;
+  case KEY_WEATHER_MODE:
+    return settings->weather_mode;
+  case KEY_DATE_FORMAT:
+    return settings->date_format;
+  case KEY_SECONDS_TIMEOUT:
+    return settings->seconds_timeout;
+  case KEY_SQUARE_FACE:
+    return settings->square_face;
+  case KEY_THEME:
+    return settings->theme;
+  case KEY_SWEEP_SECONDS:
+    return settings->sweep_seconds;
+  default:
+    return 0;
   }
-  
-  // Get weather update every 30*weather_mode minutes
-  if((got_weather == false  || (t->tm_min % 30*weather_mode == 0 && t->tm_sec % 60 == 0 && weather_mode < 3)) && weather_mode > 0 ) {
-    request_temperature();
-  }  
-  
-  if(tap_counter >= 0){
-    if(tap_counter == 0){
-      //switch to timer
-      show_tap_display(false);
-    }
-    tap_counter--;
-  }  
 }
 
-static void parse_config_message(DictionaryIterator *iterator, void *context){
+//Decode a config message into a staged copy of the settings, then apply only
+//what changed: each affected subsystem once, followed by a single redraw.
+//The phone sends only the settings that changed, packed into one byte array:
+//the schema version, then a key and a value byte per setting
+static void parse_config_message(Tuple *packed){
+  if(packed->type != TUPLE_BYTE_ARRAY){
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Config is not a byte array!");
+    return;
+  }
+  const uint8_t *data = packed->value->data;
+  if(packed->length < 1 || data[0] != CONFIG_SCHEMA_VERSION){
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Config schema %d not supported!", packed->length < 1 ? -1 : (int)data[0]);
+    return;
+  }
   
-  Tuple *t = dict_read_first(iterator);
+  Settings staged = s_settings;
+  for(uint16_t i = 1; i + 1 < packed->length; i += 2){
+    stage_config_value(&staged, data[i], data[i + 1]);
+  }
   
-    // For all items
-  while(t != NULL) {
-    // Which key was received?
-    switch(t->key) {
-    case KEY_HIDE_SECONDS:
-      hide_second_hand = (int)(t->value->int32);
-      persist_write_bool(KEY_HIDE_SECONDS,hide_second_hand);
-      break;
-    case KEY_BT_LOGO_TYPE:
-      if((int)t->value->int32){
-        bt_image_type = BT_IMAGE_LARGE;
-      }else{
-        bt_image_type = BT_IMAGE_SMALL;        
-      }
-      update_bt_img(bluetooth_connection_service_peek());       
-      persist_write_int(KEY_BT_LOGO_TYPE, bt_image_type);   
-      break;      
-    case KEY_TEMP_SCALE:
-      if(temp_scale != (int)t->value->int32){
-        temp_scale = (int)t->value->int32;
-        request_temperature();
-      }      
-      persist_write_int(KEY_TEMP_SCALE, temp_scale);            
-      break;      
-    case KEY_SHOW_ANIMATION:
-      show_animation = (int)(t->value->int32);
-      persist_write_bool(KEY_SHOW_ANIMATION,show_animation);
-      break;
-    case KEY_HOUR_COLOR:
-      hours_color = (int)t->value->int32;
-      persist_write_int(KEY_HOUR_COLOR, hours_color);                     
-      break;
-    case KEY_MINUTE_COLOR:
-      minutes_color = (int)t->value->int32;
-      persist_write_int(KEY_MINUTE_COLOR, minutes_color);                              
-      break;
-    case KEY_SECOND_COLOR:
-      seconds_color = (int)t->value->int32;
-      persist_write_int(KEY_SECOND_COLOR, seconds_color);                                       
-      break;     
-    case KEY_WEATHER_MODE:
-      if(weather_mode == 0 && (int)t->value->int32 > 0){
-        request_temperature();
-      }
-      weather_mode = (int)t->value->int32;              
-      persist_write_int(KEY_WEATHER_MODE, weather_mode);   
-      break;  
-    case KEY_DATE_FORMAT:
-      if(date_format != (int)t->value->int32){
-        date_format = (int)t->value->int32;        
-        update_date();
-      }
-      persist_write_int(KEY_DATE_FORMAT, date_format);   
-      break;  
-    case KEY_SQUARE_FACE:
-      square_face = (int)t->value->int32;      
-      #if defined PBL_RECT
-      if(square_face == true){
-        set_container_image(&s_bg_bitmap, s_bg_layer, RESOURCE_ID_BG_SQUARE, 0, 0);
-      }
-      else{
-        set_container_image(&s_bg_bitmap, s_bg_layer, RESOURCE_ID_BG_ROUND, 0, 0);        
-      }
-      #endif
-      persist_write_int(KEY_SQUARE_FACE, square_face);   
-      break;        
-    default:
-      APP_LOG(APP_LOG_LEVEL_ERROR, "Key %d not recognized!", (int)t->key);
-      break;
+  Settings old = s_settings;
+  s_settings = staged;
+  
+  if(s_settings.bt_image_type != old.bt_image_type){
+    load_bt_img();
+  }
+  #if defined PBL_RECT
+  if(s_settings.square_face != old.square_face){
+    load_background();
+  }
+  #endif
+  
+  if(s_settings.theme != old.theme){
+    //Recolors the loaded bitmaps in place, the background among them
+    theme_set(s_settings.theme);
+    invalidate_under();
+  }
+  
+  if(s_settings.weather_mode != old.weather_mode){
+    //Turning weather on shows the stored reading until a fresh one arrives
+    int16_t celsius;
+    if(s_settings.weather_mode > 0 && weather_scheduler_last_reading(&celsius)){
+      state_set_temperature(celsius);
+    }else if(s_settings.weather_mode == 0){
+      state_clear_temperature();
     }
-    
-    t = dict_read_next(iterator);
+    refresh_weather_if_stale();
+  }
+  if(s_settings.hide_second_hand != old.hide_second_hand || s_settings.seconds_timeout != old.seconds_timeout ||
+     s_settings.sweep_seconds != old.sweep_seconds){
+    wake_seconds();
   }
   
-  layer_mark_dirty(s_hands_layer);
+  settings_save(&s_settings);
+  state_set_settings(&s_settings);
+  update_display();
 }
 
 static void parse_weather_message(DictionaryIterator *iterator, void *context){
-  if(weather_mode == 0){
+  weather_scheduler_received();
+  if(s_settings.weather_mode == 0){
     return;
   }
   int temperature = 0;
   bool got_temperature = false;
-  bool neg_temp = false;  
   
   APP_LOG(APP_LOG_LEVEL_ERROR, "Getting weather");
-  got_weather = true;
   
   Tuple *t = dict_read_first(iterator);
 
@@ -550,9 +830,6 @@ static void parse_weather_message(DictionaryIterator *iterator, void *context){
     switch(t->key) {
     case KEY_TEMPERATURE:
       temperature = (int)t->value->int32;
-      if(temp_scale == FAHRENHEIT_SCALE){
-        temperature = temperature * 9/5 + 32;
-      }
       got_temperature = true;
       break;
     default:
@@ -567,83 +844,66 @@ static void parse_weather_message(DictionaryIterator *iterator, void *context){
   APP_LOG(APP_LOG_LEVEL_ERROR, "Temp: %d", temperature);
 
   if(got_temperature){
-    if(temperature < 0){
-      temperature = -temperature;
-      neg_temp = true;
-    }
-    
-    int t1 = temperature/100;
-    int t2 = (temperature%100)/10;
-    int t3 = temperature%10;
-    
-    int x = 0;
-    int y = 0;
-    #if defined(PBL_ROUND)
-    y = y + RECTWIDTH;    
-    if(t1 == 0 && !neg_temp){  
-      x = x + RECTWIDTH;
-    }
-    #endif
-    
-    if(t1 != 0){
-      set_container_image(&s_temp_digits_bitmap[0], s_temp_digits_layer[0], DIGIT_IMAGE_RESOURCE_IDS[t1], x, y);  
-      x += 4*RECTWIDTH;
-    } else if(neg_temp){
-      set_container_image(&s_temp_digits_bitmap[0], s_temp_digits_layer[0], RESOURCE_ID_NEGATIVE, x, y);        
-      x += 4*RECTWIDTH;
-    } else if(s_temp_digits_bitmap[0] != NULL){
-      gbitmap_destroy(s_temp_digits_bitmap[0]);
-      s_temp_digits_bitmap[0] = NULL;
-      bitmap_layer_set_bitmap(s_temp_digits_layer[0], NULL);      
-    }
-    if(t2 != 0 || t1 != 0){
-      set_container_image(&s_temp_digits_bitmap[1], s_temp_digits_layer[1], DIGIT_IMAGE_RESOURCE_IDS[t2], x, y);  
-      x += 4*RECTWIDTH;  	
-    }
-    else{
-      x += 2*RECTWIDTH;
-      if(s_temp_digits_bitmap[1] != NULL){
-        gbitmap_destroy(s_temp_digits_bitmap[1]);
-        s_temp_digits_bitmap[1] = NULL;
-        bitmap_layer_set_bitmap(s_temp_digits_layer[1], NULL);
-      }
-    }
-    set_container_image(&s_temp_digits_bitmap[2], s_temp_digits_layer[2], DIGIT_IMAGE_RESOURCE_IDS[t3], x, y);  
-    x += 4*RECTWIDTH;  	
-    set_container_image(&s_temp_digits_bitmap[3], s_temp_digits_layer[3], RESOURCE_ID_DEGREE, x, y);          
+    weather_scheduler_store(temperature);
+    state_set_temperature(temperature);
+    update_display();
   }
 }
 
 static void inbox_received_callback(DictionaryIterator *iterator, void *context) {  
-  Tuple *weather_tuple = dict_find(iterator, WEATHER_MESSAGE);
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  PROFILE_TALLY(PROFILE_APPMESSAGES_RECEIVED);
+  if(dict_find(iterator, KEY_PROFILE_DUMP) != NULL){
+    PROFILE_DUMP();
+    log_sweep_counts();
+    heap_budget_report();
+    return;
+  }
+  
+  Tuple *config_tuple = dict_find(iterator, KEY_CONFIG_PACKED);
+  if(config_tuple != NULL){
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Got config");    
+    parse_config_message(config_tuple);
+    return;
+  }
   
-  if((int)weather_tuple->value->int32 == 1){
+  Tuple *weather_tuple = dict_find(iterator, WEATHER_MESSAGE);
+  if(weather_tuple != NULL && (int)weather_tuple->value->int32 == 1){
     APP_LOG(APP_LOG_LEVEL_ERROR, "Got weather");
     parse_weather_message(iterator,  context);
   }
-  else{
-    APP_LOG(APP_LOG_LEVEL_ERROR, "Got config");    
-    parse_config_message(iterator,  context);
-  }
 }
 
 static void inbox_dropped_callback(AppMessageResult reason, void *context) {
   APP_LOG(APP_LOG_LEVEL_ERROR, "Message dropped!");
 }
 
-static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResult reason, void *context) {
-  APP_LOG(APP_LOG_LEVEL_ERROR, "Outbox send failed!");
+//Reported once per launch, in the layout of a config push, so the phone diffs
+//its next push against what the watch holds: a reset or reinstalled watch,
+//or a push it rejected, shows up here
+static void write_outbox(OutboxMessage message, DictionaryIterator *iter) {
+  if(message == OUTBOX_CONFIG_REPORT){
+    uint8_t packed[1 + 2 * ARRAY_LENGTH(CONFIG_KEYS)];
+    packed[0] = CONFIG_SCHEMA_VERSION;
+    for(unsigned i = 0; i < ARRAY_LENGTH(CONFIG_KEYS); i++){
+      packed[1 + 2 * i] = CONFIG_KEYS[i];
+      packed[2 + 2 * i] = config_value(&s_settings, CONFIG_KEYS[i]);
+    }
+    dict_write_data(iter, KEY_CONFIG_PACKED, packed, sizeof(packed));
+  }
 }
 
-static void outbox_sent_callback(DictionaryIterator *iterator, void *context) {
-  APP_LOG(APP_LOG_LEVEL_INFO, "Outbox send success!");
+static void outbox_result(OutboxMessage message, bool sent) {
+  if(message == OUTBOX_WEATHER_REQUEST){
+    weather_scheduler_sent(sent);
+  }
 }
 
 
 static void main_window_load(Window *window) {
+  PROFILE_START(start);
   Layer *window_layer = window_get_root_layer(window);
   GRect bounds = layer_get_bounds(window_layer);
-  GRect dummy_frame = { {0, 0}, {0, 0} };
   
   uint8_t c_x = RECTWIDTH*(int)(bounds.size.w/(2*RECTWIDTH));
   uint8_t batlayer_y = c_x + RECTWIDTH*21;  
@@ -659,157 +919,87 @@ static void main_window_load(Window *window) {
   daylayer_x = c_x - RECTWIDTH*8;    
   bt_x = c_x - 3*RECTWIDTH;
   bt_y = c_x - RECTWIDTH*17;
-  
-  s_bg_bitmap = gbitmap_create_with_resource(RESOURCE_ID_BG_ROUND);  
-  s_bg_layer = create_bitmap_layer(s_bg_bitmap, window_layer, 0,0,RECTWIDTH*WIDTH,RECTWIDTH*HEIGHT);
-    
-  #elif defined (PBL_RECT)
-  //create bg layers
-  
-  if(square_face){
-    s_bg_bitmap = gbitmap_create_with_resource(RESOURCE_ID_BG_SQUARE);  
-  }
-  else{
-    s_bg_bitmap = gbitmap_create_with_resource(RESOURCE_ID_BG_ROUND);  
-  }
-  s_bg_layer = create_bitmap_layer(s_bg_bitmap, window_layer, 0,0,RECTWIDTH*WIDTH,RECTWIDTH*HEIGHT);   
   #endif
   
+  //One layer draws everything, back to front
+  load_background();
+  layer_add_child(window_layer, compositor_create(bounds));
+  compositor_add(WIDGET_BACKGROUND, bounds, draw_background);
+  compositor_add(WIDGET_CELLS, bounds, draw_cells);
   
+  //battery, date, day name and temperature are drawn into the cell grid
+  s_battery_origin = GPoint(batlayer_x / RECTWIDTH, batlayer_y / RECTWIDTH);
+  s_date_origin = GPoint(daylayer_x / RECTWIDTH, daylayer_y / RECTWIDTH);
+  s_day_origin = GPoint(s_date_origin.x + 6, s_date_origin.y);
+  #if defined(PBL_ROUND)
+  s_day_origin.x = s_date_origin.x + 3;
+  #endif
   
-  //create hands layer
-  s_hands_layer = layer_create(bounds);
-  layer_set_update_proc(s_hands_layer, hands_update_proc);
-  layer_add_child(window_layer, s_hands_layer);
-  
-  //create date layer
-  s_date_layer = layer_create(GRect(daylayer_x,daylayer_y,20*RECTWIDTH,4*RECTWIDTH));
- // layer_set_update_proc(s_date_layer, date_update_proc);
-  layer_add_child(window_layer, s_date_layer);
-  
-  memset(&s_date_digits_layer, 0, sizeof(s_date_digits_layer));
-  
-  for (int i = 0; i < 5; ++i) {
-    s_date_digits_layer[i] = bitmap_layer_create(dummy_frame);
-    layer_add_child(s_date_layer, bitmap_layer_get_layer(s_date_digits_layer[i]));
+  //Show the last known temperature until a fresh one arrives
+  int16_t celsius;
+  if(s_settings.weather_mode > 0 && weather_scheduler_last_reading(&celsius)){
+    state_set_temperature(celsius);
   }
-    
-  //create day of week layer
-  s_day_layer = bitmap_layer_create(GRect(daylayer_x,daylayer_y,20*RECTWIDTH,4*RECTWIDTH));
-  layer_add_child(window_layer, bitmap_layer_get_layer(s_day_layer));
-  layer_set_hidden(bitmap_layer_get_layer(s_day_layer), true);
+  s_temp_origin = GPoint(batlayer_x / RECTWIDTH + 1, batlayer_y / RECTWIDTH - 1);
   
-  //create temperature layer
-  s_temp_layer = layer_create(GRect(batlayer_x + RECTWIDTH, batlayer_y - RECTWIDTH,17*RECTWIDTH,5*RECTWIDTH));
-  layer_add_child(window_layer, s_temp_layer);
-  
-  memset(&s_temp_digits_layer, 0, sizeof(s_temp_digits_layer));
-  
-  for (int i = 0; i < 4; ++i) {
-    s_temp_digits_layer[i] = bitmap_layer_create(dummy_frame);
-    layer_add_child(s_temp_layer, bitmap_layer_get_layer(s_temp_digits_layer[i]));
-  }  
-  
-  layer_set_hidden(s_temp_layer, true);
-  
-  //create battery layer
-  s_battery_layer = layer_create(GRect(batlayer_x, batlayer_y,13*RECTWIDTH,3*RECTWIDTH));
-  layer_set_update_proc(s_battery_layer, battery_update_proc);
-  layer_add_child(window_layer, s_battery_layer);
-  
-  //create bluetooth layer
-  s_bt_layer = layer_create(GRect(bt_x, bt_y,7*RECTWIDTH,7*RECTWIDTH));
-  layer_add_child(window_layer, s_bt_layer);  
-
-  //Bluetooth img
-  s_bt_img_layer = bitmap_layer_create(dummy_frame);
-  layer_add_child(s_bt_layer, bitmap_layer_get_layer(s_bt_img_layer)); 
-    
+  //Bluetooth icon, baked into the cells like the rest
+  s_bt_origin = GPoint(bt_x / RECTWIDTH, bt_y / RECTWIDTH);
   
   //Initial draw of details
-  update_date();  
-  update_bt_img(bluetooth_connection_service_peek());  
+  load_bt_img();
+  PROFILE_END(PROFILE_WINDOW_LOAD, start);
+}
 
-  layer_mark_dirty(window_get_root_layer(s_main_window));
+static void main_window_appear(Window *window) {
+  //Another window may have drawn over the framebuffer
+  request_full_redraw();
 }
 
 static void main_window_unload(Window *window) {
   // Destroy Layers
-  destroy_bitmap_layer(s_bg_layer, s_bg_bitmap );
+  theme_bitmap_destroy(HEAP_BACKGROUND, s_bg_bitmap);
+  s_bg_bitmap = NULL;
   
-  for(int i = 0; i < 5; i++){
-    destroy_bitmap_layer(s_date_digits_layer[i], s_date_digits_bitmap[i] );    
-  }   
-  
-  for(int i = 0; i < 4; i++){
-    destroy_bitmap_layer(s_temp_digits_layer[i], s_temp_digits_bitmap[i] );    
-  }  
-  
-  destroy_bitmap_layer(s_bt_img_layer, s_bt_img_bitmap);   
-  destroy_bitmap_layer(s_day_layer, s_day_bitmap);        
+  if(s_bt_img_bitmap != NULL){
+    theme_bitmap_destroy(HEAP_BLUETOOTH, s_bt_img_bitmap);
+    s_bt_img_bitmap = NULL;
+  }
   
-  layer_destroy(s_hands_layer);    
-  layer_destroy(s_battery_layer);  
-  layer_destroy(s_date_layer);    
-  layer_destroy(s_bt_layer);  
-  layer_destroy(s_temp_layer); 
+  compositor_destroy();
   
 }
 
 
 static void init() {
+  #if defined(PROFILE_RENDER)
+  s_init_start = profile_now();
+  #endif
   
   srand(time(NULL));
   
-  seconds_color = BLUE;
-  minutes_color = WHITE;
-  hours_color = WHITE;
-  bt_image_type = BT_IMAGE_SMALL;
-  temp_scale = CELSIUS_SCALE; 
-  date_format = DDMM_DATE_FORMAT;
-  hide_second_hand = false;
-  show_animation = true;  
-  square_face = false;
-  weather_mode = 1;
-  
-  if(persist_exists(KEY_SECOND_COLOR)){
-    seconds_color = persist_read_int(KEY_SECOND_COLOR);
-  }
-  if(persist_exists(KEY_SQUARE_FACE)){
-    square_face = persist_read_int(KEY_SQUARE_FACE);
-  }
-  if(persist_exists(KEY_HOUR_COLOR)){
-    hours_color = persist_read_int(KEY_HOUR_COLOR);
-  }
-  if(persist_exists(KEY_MINUTE_COLOR)){
-    minutes_color = persist_read_int(KEY_MINUTE_COLOR);
-  }
-  if(persist_exists(KEY_TEMP_SCALE)){
-    temp_scale = persist_read_int(KEY_TEMP_SCALE);
-  }
-  if(persist_exists(KEY_BT_LOGO_TYPE)){
-    bt_image_type = persist_read_int(KEY_BT_LOGO_TYPE);
-  }
-  if(persist_exists(KEY_SHOW_ANIMATION)){
-    show_animation = persist_read_bool(KEY_SHOW_ANIMATION);
-  }  
-  if(persist_exists(KEY_HIDE_SECONDS)){
-    hide_second_hand = persist_read_bool(KEY_HIDE_SECONDS);
-  }  
-  if(persist_exists(KEY_WEATHER_MODE)){
-    weather_mode = persist_read_int(KEY_WEATHER_MODE);
-  }   
-  if(persist_exists(KEY_DATE_FORMAT)){
-    date_format = persist_read_int(KEY_DATE_FORMAT);
-  }  
+  settings_load(&s_settings);  
+  theme_set(s_settings.theme);
+  weather_scheduler_init();
   
+  //Seed the state once; from here on the service handlers keep it current
+  time_t now = time(NULL);
+  state_set_time(localtime(&now));
+  state_set_battery(battery_state_service_peek());
+  state_set_bluetooth(bluetooth_connection_service_peek());
+  state_set_settings(&s_settings);
+  //The first frame bakes everything anyway
+  state_take_changes();
   
   // Create main Window element and assign to pointer
-  s_main_window = window_create();
+  s_main_window = heap_window_create(HEAP_WINDOW);
+  
+  //No window fill: frames only repaint the region that changed
+  window_set_background_color(s_main_window, GColorClear);
 
   // Set handlers to manage the elements inside the Window
   window_set_window_handlers(s_main_window, (WindowHandlers) {
     .load = main_window_load,
+    .appear = main_window_appear,
     .unload = main_window_unload
   });
 
@@ -819,32 +1009,38 @@ static void init() {
   // Register callbacks
   app_message_register_inbox_received(inbox_received_callback);
   app_message_register_inbox_dropped(inbox_dropped_callback);
-  app_message_register_outbox_failed(outbox_failed_callback);
-  app_message_register_outbox_sent(outbox_sent_callback);
+  outbox_init(write_outbox, outbox_result);
   
   // Register with Services
-  tick_timer_service_subscribe(SECOND_UNIT, handle_second_tick);
+  wake_seconds();
   accel_tap_service_subscribe(tap_handler);  
   battery_state_service_subscribe(battery_handler);
   bluetooth_connection_service_subscribe(bt_handler);    
   
-  if(show_animation){
-    timer = app_timer_register(delta, (AppTimerCallback) timer_callback, NULL); 
+  if(s_settings.show_animation){
+    start_intro();
   }else{
     clock_ready = true;
   }
-  app_message_open(app_message_inbox_size_maximum(), app_message_outbox_size_maximum());  
+  heap_app_message_open(HEAP_APP_MESSAGE, app_message_inbox_size_maximum(), app_message_outbox_size_maximum());  
+  
+  outbox_enqueue(OUTBOX_CONFIG_REPORT);
+  refresh_weather_if_stale();
 }
 
 
 static void deinit() {
+    #if defined(PROFILE_RENDER)
+    log_sweep_counts();
+    #endif
+    intro_animation_cancel();
     tick_timer_service_unsubscribe(); 
     accel_tap_service_unsubscribe();
     battery_state_service_unsubscribe();
     bluetooth_connection_service_unsubscribe();
     app_message_deregister_callbacks();
     // Destroy Window
-    window_destroy(s_main_window);
+    heap_window_destroy(HEAP_WINDOW, s_main_window);
 }
 
 int main(void) {
@@ -0,0 +1,103 @@
+#include "outbox.h"
+#include "profile.h"
+
+// FIFO of waiting messages, each at most once
+static OutboxMessage s_queue[NUM_OUTBOX_MESSAGES];
+static uint8_t s_queue_length;
+static bool s_queued[NUM_OUTBOX_MESSAGES];
+
+static bool s_sending = false;
+static OutboxMessage s_in_outbox;
+static OutboxWriteHandler s_writer;
+static OutboxResultHandler s_handler;
+static AppTimer *s_busy_timer;
+
+#define OUTBOX_BUSY_RETRY_MS 100
+
+static void write_message(DictionaryIterator *iter, OutboxMessage message){
+  switch(message){
+  case OUTBOX_WEATHER_REQUEST:
+    dict_write_uint8(iter, 0, 0);
+    break;
+  default:
+    s_writer(message, iter);
+    break;
+  }
+}
+
+static void pop(){
+  s_queued[s_queue[0]] = false;
+  s_queue_length--;
+  memmove(&s_queue[0], &s_queue[1], s_queue_length * sizeof(s_queue[0]));
+}
+
+static void send_next();
+
+static void busy_timer_callback(void *data){
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  s_busy_timer = NULL;
+  send_next();
+}
+
+static void send_next(){
+  if(s_sending || s_busy_timer != NULL || s_queue_length == 0){
+    return;
+  }
+
+  OutboxMessage message = s_queue[0];
+  DictionaryIterator *iter;
+  AppMessageResult result = app_message_outbox_begin(&iter);
+  if(result == APP_MSG_BUSY){
+    // The outbox is still being torn down, try again shortly
+    s_busy_timer = app_timer_register(OUTBOX_BUSY_RETRY_MS, busy_timer_callback, NULL);
+    return;
+  }
+  if(result == APP_MSG_OK){
+    write_message(iter, message);
+    result = app_message_outbox_send();
+  }
+
+  pop();
+  if(result == APP_MSG_OK){
+    PROFILE_TALLY(PROFILE_APPMESSAGES_SENT);
+    s_sending = true;
+    s_in_outbox = message;
+  }else{
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Outbox send failed to start: %d", (int)result);
+    s_handler(message, false);
+    send_next();
+  }
+}
+
+static void finish(bool sent){
+  s_sending = false;
+  s_handler(s_in_outbox, sent);
+  send_next();
+}
+
+static void outbox_sent_callback(DictionaryIterator *iterator, void *context) {
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  APP_LOG(APP_LOG_LEVEL_INFO, "Outbox send success!");
+  finish(true);
+}
+
+static void outbox_failed_callback(DictionaryIterator *iterator, AppMessageResult reason, void *context) {
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  APP_LOG(APP_LOG_LEVEL_ERROR, "Outbox send failed!");
+  finish(false);
+}
+
+void outbox_init(OutboxWriteHandler writer, OutboxResultHandler handler){
+  s_writer = writer;
+  s_handler = handler;
+  app_message_register_outbox_sent(outbox_sent_callback);
+  app_message_register_outbox_failed(outbox_failed_callback);
+}
+
+void outbox_enqueue(OutboxMessage message){
+  if(!s_queued[message]){
+    s_queued[message] = true;
+    s_queue[s_queue_length++] = message;
+  }
+  send_next();
+}
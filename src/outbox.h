@@ -0,0 +1,23 @@
+#pragma once
+
+#include <pebble.h>
+
+// Every outbound AppMessage goes through this queue. A message that is
+// already waiting is not queued twice, and nothing is sent while the
+// previous message is still in the outbox.
+
+typedef enum {
+  OUTBOX_WEATHER_REQUEST,
+  // The settings the watch holds, written by the app
+  OUTBOX_CONFIG_REPORT,
+  NUM_OUTBOX_MESSAGES
+} OutboxMessage;
+
+// Writes a message whose contents the app owns, when it is sent
+typedef void (*OutboxWriteHandler)(OutboxMessage message, DictionaryIterator *iter);
+// Called once per sent message, sent is false if delivery failed
+typedef void (*OutboxResultHandler)(OutboxMessage message, bool sent);
+
+// Registers the AppMessage outbox callbacks, call before app_message_open
+void outbox_init(OutboxWriteHandler writer, OutboxResultHandler handler);
+void outbox_enqueue(OutboxMessage message);
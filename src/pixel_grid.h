@@ -1,16 +1,6 @@
 #include <pebble.h>
+#include "cell_grid.h"
 
-#if defined(PBL_RECT)
-#define RECTWIDTH 4
-#define RECTHEIGHT  4
-#define WIDTH (144 / RECTWIDTH)
-#define HEIGHT (168 / RECTHEIGHT)
-#elif defined(PBL_ROUND)
-#define RECTWIDTH 4
-#define RECTHEIGHT 4
-#define WIDTH (180 / RECTWIDTH)
-#define HEIGHT (180 / RECTHEIGHT)
-#endif
 #define NUM_COLOR 8
 #define KEY_TEMPERATURE 2
 #define KEY_HOUR_COLOR 3
@@ -23,6 +13,11 @@
 #define KEY_WEATHER_MODE 10
 #define KEY_SQUARE_FACE 11
 #define KEY_DATE_FORMAT 12
+#define KEY_SECONDS_TIMEOUT 13
+#define KEY_PROFILE_DUMP 14
+#define KEY_THEME 15
+#define KEY_CONFIG_PACKED 16
+#define KEY_SWEEP_SECONDS 17
 
 
 
@@ -35,7 +30,10 @@
 #define FAHRENHEIT_SCALE 1
 #define DDMM_DATE_FORMAT 0  
 #define MMDD_DATE_FORMAT 1  
+//Layout of the KEY_CONFIG_PACKED byte array
+#define CONFIG_SCHEMA_VERSION 1
   
+//Tap display durations, in seconds
 enum {
   TAP_DURATION_SHORT = 0x3,
   TAP_DURATION_MED = 0x4,
@@ -53,36 +51,66 @@ enum {
   ORANGE = 0x7
 };
 
-const int DAY_NAME_IMAGE_RESOURCE_IDS[] = {
-  RESOURCE_ID_SUN,
-  RESOURCE_ID_MON,
-  RESOURCE_ID_TUE,
-  RESOURCE_ID_WED,
-  RESOURCE_ID_THU,
-  RESOURCE_ID_FRI,
-  RESOURCE_ID_SAT
+//Cell font glyphs, digits first so a digit is its own glyph index
+enum {
+  GLYPH_DIGIT0,
+  GLYPH_SLASH = 10,
+  GLYPH_DEGREE,
+  GLYPH_NEGATIVE,
+  GLYPH_SUN,
+  GLYPH_MON,
+  GLYPH_TUE,
+  GLYPH_WED,
+  GLYPH_THU,
+  GLYPH_FRI,
+  GLYPH_SAT,
+  NUM_GLYPHS
 };
 
-const int DIGIT_IMAGE_RESOURCE_IDS[10] = {
-  RESOURCE_ID_DIGIT0,
-  RESOURCE_ID_DIGIT1,
-  RESOURCE_ID_DIGIT2B,
-  RESOURCE_ID_DIGIT3,
-  RESOURCE_ID_DIGIT4,
-  RESOURCE_ID_DIGIT5,  
-  RESOURCE_ID_DIGIT6,
-  RESOURCE_ID_DIGIT7B,
-  RESOURCE_ID_DIGIT8,
-  RESOURCE_ID_DIGIT9
+#define GLYPH_HEIGHT 4
+
+//One bit per cell, leftmost cell in the highest bit. Backed glyphs paint
+//their unlit cells too, so they stay readable over a hand
+typedef struct {
+  uint8_t width;
+  bool backed;
+  uint16_t rows[GLYPH_HEIGHT];
+} Glyph;
+
+static const Glyph GLYPHS[NUM_GLYPHS] = {
+  {3, true, {0b111, 0b101, 0b101, 0b111}}, //0
+  {3, true, {0b110, 0b010, 0b010, 0b111}}, //1
+  {3, true, {0b110, 0b001, 0b110, 0b111}}, //2
+  {3, true, {0b111, 0b001, 0b011, 0b111}}, //3
+  {3, true, {0b101, 0b101, 0b011, 0b001}}, //4
+  {3, true, {0b111, 0b110, 0b001, 0b111}}, //5
+  {3, true, {0b111, 0b100, 0b111, 0b111}}, //6
+  {3, true, {0b111, 0b001, 0b010, 0b010}}, //7
+  {3, true, {0b111, 0b111, 0b101, 0b111}}, //8
+  {3, true, {0b111, 0b111, 0b001, 0b111}}, //9
+  {2, false, {0b01, 0b01, 0b10, 0b10}}, //slash
+  {3, false, {0b110, 0b110, 0b000, 0b000}}, //degree
+  {3, false, {0b000, 0b000, 0b011, 0b000}}, //minus
+  {12, false, {0b011101010110, 0b010001010101, 0b001101010101, 0b011100110101}}, //SUN
+  {12, false, {0b111101100110, 0b101101010101, 0b101101010101, 0b100100110101}}, //MON
+  {12, false, {0b011101010111, 0b001001010100, 0b001001010110, 0b001000110111}}, //TUE
+  {12, false, {0b100101110110, 0b101101000101, 0b101101100101, 0b111101110110}}, //WED
+  {12, false, {0b011101010101, 0b001001010101, 0b001001110101, 0b001001010011}}, //THU
+  {12, false, {0b011101100111, 0b010001010010, 0b011001100010, 0b010001010111}}, //FRI
+  {12, false, {0b011101100111, 0b010001010010, 0b001101110010, 0b011101010010}}  //SAT
 };
 
   
 static const uint8_t BAT_WARN_LEVEL = 50;
 static const uint8_t BAT_ALERT_LEVEL = 20;
-static const float HI_COLOR_THRESHOLD = 0.7;
-static const float MID_COLOR_THRESHOLD = 0.35;
-static const float LO_COLOR_THRESHOLD = 0.1;
 
+//The sweeping second hand ticks instead below this charge, unless plugged in,
+//and after this long without a tap
+static const uint8_t SWEEP_MIN_CHARGE = 30;
+#define SWEEP_IDLE_MS (2 * 60 * 1000)
+
+//Hand shades, brightest first; the anti-aliasing thresholds that pick them
+//live in tools/hand_tables.py
 static const uint8_t COLOR_SETS[NUM_COLOR][3] = {
   {GColorWhiteARGB8, GColorLightGrayARGB8, GColorDarkGrayARGB8}, //WHITE
   {GColorRedARGB8, GColorDarkCandyAppleRedARGB8, GColorBulgarianRoseARGB8}, //RED
@@ -95,34 +123,16 @@ static const uint8_t COLOR_SETS[NUM_COLOR][3] = {
 };
    
 
-static const struct GPathInfo BAT_CASE_POINTS = {
-  27, 
-  (GPoint []){
-    {0,0}, {1,0}, {2,0}, {3,0}, {4,0}, {5,0}, 
-    {6,0}, {7,0}, {8,0}, {9,0}, {10,0}, {11,0}, 
-    {0,2}, {1,2}, {2,2}, {3,2}, {4,2}, {5,2}, 
-    {6,2}, {7,2}, {8,2}, {9,2}, {10,2}, {11,2},       
-    {0,1}, {11,1}, {12,1}
-  }
-};
+#define SHAPE_HEIGHT 3
 
-static const struct GPathInfo PM_POINTS = {
-  16,
-  (GPoint[]){
-    {1,0}, {1,1}, {1,2}, {2,0},
-    {2,1}, {3,0}, {3,1}, {5,0}, 
-    {5,1}, {5,2}, {6,0}, {7,0}, 
-    {7,1}, {8,0}, {8,1}, {8,2}
-  }
-}; 
+//Fixed icons, one bit per cell like the glyphs
+typedef struct {
+  uint8_t width;
+  uint16_t rows[SHAPE_HEIGHT];
+} Shape;
+
+static const Shape BAT_CASE_SHAPE = {13, {0b1111111111110, 0b1000000000011, 0b1111111111110}};
+
+static const Shape PM_SHAPE = {9, {0b011101111, 0b011101011, 0b010001001}};
 
-static const struct GPathInfo CHARGE_POINTS = {
-  11,
-  (GPoint[]){
-    {0,0}, {3,0}, {4,0}, {1,1}, {2,1}, {3,1},
-    {4,1}, {5,1}, {2,2}, {3,2}, {6,2}
-  }
- /* 6,
-  (GPoint[]){{6,0}, {5,1}, {5,2}, {6,2}, {6,3}, {5,4}}*/
- 
-};    
\ No newline at end of file
+static const Shape CHARGE_SHAPE = {7, {0b1001100, 0b0111110, 0b0011001}};    
\ No newline at end of file
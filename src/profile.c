@@ -0,0 +1,170 @@
+#include "profile.h"
+
+#if defined(PROFILE_RENDER)
+
+// Buckets are powers of two in ms: 0, 1, 2-3, 4-7, ... and the last one
+// takes everything slower
+#define PROFILE_BUCKETS 8
+#define PROFILE_RING_SIZE 32
+
+typedef struct {
+  uint8_t section;
+  uint16_t ms;
+} ProfileSample;
+
+static const char *SECTION_NAMES[NUM_PROFILE_SECTIONS] = {
+  "composite",
+  "render_cells",
+  "window_load",
+  "first_frame",
+  "remap_palette",
+  "remap_8bit",
+  "bake",
+  "sweep"
+};
+
+static const char *COUNTER_NAMES[NUM_PROFILE_COUNTERS] = {
+  "fill_calls",
+  "cells_painted",
+  "remap_palette_bytes",
+  "remap_8bit_bytes"
+};
+
+static const char *TALLY_NAMES[NUM_PROFILE_TALLIES] = {
+  "wakeups",
+  "redraws",
+  "appmessages_sent",
+  "appmessages_received",
+  "resource_loads",
+  "flash_writes"
+};
+
+// Rough relative cost of one event, for ranking runs against each other; not
+// a calibrated energy figure. The radio and flash dwarf a wakeup
+static const uint16_t TALLY_COST[NUM_PROFILE_TALLIES] = {
+  1,  // wakeups
+  4,  // redraws
+  50, // appmessages_sent
+  30, // appmessages_received
+  8,  // resource_loads
+  20  // flash_writes
+};
+// Painted cells add one unit per this many
+#define CELLS_PER_COST_UNIT 100
+
+static uint16_t s_histograms[NUM_PROFILE_SECTIONS][PROFILE_BUCKETS];
+static uint16_t s_max_ms[NUM_PROFILE_SECTIONS];
+static uint32_t s_total_ms[NUM_PROFILE_SECTIONS];
+
+static uint32_t s_counter_frames[NUM_PROFILE_COUNTERS];
+static uint32_t s_counter_total[NUM_PROFILE_COUNTERS];
+static uint32_t s_counter_max[NUM_PROFILE_COUNTERS];
+static uint32_t s_counter_last[NUM_PROFILE_COUNTERS];
+
+static uint32_t s_tallies[NUM_PROFILE_TALLIES];
+// First profiling event, the start of the tally period
+static uint32_t s_start_ms;
+
+// Most recent samples, oldest overwritten first
+static ProfileSample s_ring[PROFILE_RING_SIZE];
+static uint8_t s_ring_head;
+static uint8_t s_ring_count;
+
+uint32_t profile_now(void){
+  time_t seconds;
+  uint16_t ms;
+  time_ms(&seconds, &ms);
+  return (uint32_t)seconds * 1000 + ms;
+}
+
+static void start_clock(){
+  if(s_start_ms == 0){
+    s_start_ms = profile_now();
+  }
+}
+
+void profile_record(ProfileSection section, uint32_t start){
+  start_clock();
+  uint32_t elapsed = profile_now() - start;
+  uint16_t ms = elapsed > UINT16_MAX ? UINT16_MAX : elapsed;
+
+  uint8_t bucket = 0;
+  while(bucket < PROFILE_BUCKETS - 1 && (ms >> bucket) != 0){
+    bucket++;
+  }
+  s_histograms[section][bucket]++;
+  s_total_ms[section] += ms;
+  if(ms > s_max_ms[section]){
+    s_max_ms[section] = ms;
+  }
+
+  s_ring[s_ring_head] = (ProfileSample) { .section = section, .ms = ms };
+  s_ring_head = (s_ring_head + 1) % PROFILE_RING_SIZE;
+  if(s_ring_count < PROFILE_RING_SIZE){
+    s_ring_count++;
+  }
+}
+
+void profile_count(ProfileCounter counter, uint32_t value){
+  start_clock();
+  s_counter_frames[counter]++;
+  s_counter_total[counter] += value;
+  s_counter_last[counter] = value;
+  if(value > s_counter_max[counter]){
+    s_counter_max[counter] = value;
+  }
+}
+
+void profile_tally(ProfileTally tally){
+  start_clock();
+  s_tallies[tally]++;
+}
+
+static uint32_t per_hour(uint32_t count, uint32_t elapsed_ms){
+  return elapsed_ms == 0 ? 0 : (uint32_t)((uint64_t)count * 3600000 / elapsed_ms);
+}
+
+// One CSV record per line so the log can be diffed between builds:
+//   section,name,total_ms,max_ms,b0,b1,b2,b4,b8,b16,b32,b64
+//   load,name,ms_per_minute
+//   counter,name,frames,total,max,last
+//   tally,name,count,per_hour
+//   cost,elapsed_s,units,units_per_hour
+//   sample,name,ms
+void profile_dump(void){
+  uint32_t elapsed_ms = profile_now() - s_start_ms;
+  for(int i = 0; i < NUM_PROFILE_SECTIONS; i++){
+    const uint16_t *h = s_histograms[i];
+    APP_LOG(APP_LOG_LEVEL_INFO, "section,%s,%lu,%u,%u,%u,%u,%u,%u,%u,%u,%u",
+            SECTION_NAMES[i], (unsigned long)s_total_ms[i], s_max_ms[i],
+            h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
+  }
+  // CPU time each section takes out of every minute of the run
+  for(int i = 0; i < NUM_PROFILE_SECTIONS; i++){
+    APP_LOG(APP_LOG_LEVEL_INFO, "load,%s,%lu", SECTION_NAMES[i],
+            (unsigned long)(per_hour(s_total_ms[i], elapsed_ms) / 60));
+  }
+
+  for(int i = 0; i < NUM_PROFILE_COUNTERS; i++){
+    APP_LOG(APP_LOG_LEVEL_INFO, "counter,%s,%lu,%lu,%lu,%lu", COUNTER_NAMES[i],
+            (unsigned long)s_counter_frames[i], (unsigned long)s_counter_total[i],
+            (unsigned long)s_counter_max[i], (unsigned long)s_counter_last[i]);
+  }
+
+  uint32_t cost = s_counter_total[PROFILE_CELLS_PAINTED] / CELLS_PER_COST_UNIT;
+  for(int i = 0; i < NUM_PROFILE_TALLIES; i++){
+    APP_LOG(APP_LOG_LEVEL_INFO, "tally,%s,%lu,%lu", TALLY_NAMES[i], (unsigned long)s_tallies[i],
+            (unsigned long)per_hour(s_tallies[i], elapsed_ms));
+    cost += s_tallies[i] * TALLY_COST[i];
+  }
+  APP_LOG(APP_LOG_LEVEL_INFO, "cost,%lu,%lu,%lu", (unsigned long)(elapsed_ms / 1000),
+          (unsigned long)cost, (unsigned long)per_hour(cost, elapsed_ms));
+
+  uint8_t index = (s_ring_head + PROFILE_RING_SIZE - s_ring_count) % PROFILE_RING_SIZE;
+  for(int i = 0; i < s_ring_count; i++){
+    APP_LOG(APP_LOG_LEVEL_INFO, "sample,%s,%u", SECTION_NAMES[s_ring[index].section], s_ring[index].ms);
+    index = (index + 1) % PROFILE_RING_SIZE;
+  }
+}
+
+#endif
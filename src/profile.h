@@ -0,0 +1,69 @@
+#pragma once
+
+#include <pebble.h>
+
+// Render timing. Uncomment to time the update paths with time_ms and keep
+// per-section histograms; release builds compile every hook out.
+//#define PROFILE_RENDER
+
+typedef enum {
+  PROFILE_COMPOSITE,
+  PROFILE_RENDER_CELLS,
+  PROFILE_WINDOW_LOAD,
+  PROFILE_FIRST_FRAME,
+  PROFILE_REMAP_PALETTE,
+  PROFILE_REMAP_8BIT,
+  PROFILE_BAKE,
+  PROFILE_SWEEP,
+  NUM_PROFILE_SECTIONS
+} ProfileSection;
+
+// Work counters, one sample per frame or per remapped bitmap; the remap
+// byte counts over the remap section times give bytes per second by format
+typedef enum {
+  PROFILE_FILL_CALLS,
+  PROFILE_CELLS_PAINTED,
+  PROFILE_REMAP_PALETTE_BYTES,
+  PROFILE_REMAP_8BIT_BYTES,
+  NUM_PROFILE_COUNTERS
+} ProfileCounter;
+
+// Events that cost battery, tallied over the whole run. The dump gives their
+// rates per hour and a weighted cost, to compare builds and settings by
+// running each on a watch or the emulator for a while
+typedef enum {
+  PROFILE_WAKEUPS,
+  PROFILE_REDRAWS,
+  PROFILE_APPMESSAGES_SENT,
+  PROFILE_APPMESSAGES_RECEIVED,
+  PROFILE_RESOURCE_LOADS,
+  PROFILE_FLASH_WRITES,
+  NUM_PROFILE_TALLIES
+} ProfileTally;
+
+#if defined(PROFILE_RENDER)
+
+uint32_t profile_now(void);
+// Add the time since start (from profile_now) to the section histogram
+void profile_record(ProfileSection section, uint32_t start);
+// Add one frame's worth of a counter
+void profile_count(ProfileCounter counter, uint32_t value);
+void profile_tally(ProfileTally tally);
+// Log every histogram, counter and the most recent samples as CSV lines
+void profile_dump(void);
+
+#define PROFILE_START(name) uint32_t name = profile_now()
+#define PROFILE_END(section, name) profile_record(section, name)
+#define PROFILE_COUNT(counter, value) profile_count(counter, value)
+#define PROFILE_TALLY(tally) profile_tally(tally)
+#define PROFILE_DUMP() profile_dump()
+
+#else
+
+#define PROFILE_START(name)
+#define PROFILE_END(section, name)
+#define PROFILE_COUNT(counter, value)
+#define PROFILE_TALLY(tally)
+#define PROFILE_DUMP()
+
+#endif
@@ -0,0 +1,116 @@
+#include "settings.h"
+#include "pixel_grid.h"
+#include "theme.h"
+#include "profile.h"
+
+// Contents of the blob in flash
+static Settings s_saved;
+
+static void set_defaults(Settings *settings){
+  *settings = (Settings) {
+    .version = SETTINGS_VERSION,
+    .seconds_color = BLUE,
+    .minutes_color = WHITE,
+    .hours_color = WHITE,
+    .bt_image_type = BT_IMAGE_SMALL,
+    .temp_scale = CELSIUS_SCALE,
+    .date_format = DDMM_DATE_FORMAT,
+    .hide_second_hand = false,
+    .show_animation = true,
+    .weather_mode = 1,
+    .square_face = false,
+    .seconds_timeout = 0,
+    .theme = THEME_CLASSIC,
+    .sweep_seconds = false
+  };
+}
+
+// Settings used to be stored one per key, under their message keys
+static const uint32_t LEGACY_KEYS[] = {
+  KEY_SECOND_COLOR, KEY_MINUTE_COLOR, KEY_HOUR_COLOR, KEY_BT_LOGO_TYPE, KEY_TEMP_SCALE,
+  KEY_DATE_FORMAT, KEY_HIDE_SECONDS, KEY_SHOW_ANIMATION, KEY_WEATHER_MODE, KEY_SQUARE_FACE,
+  KEY_SECONDS_TIMEOUT
+};
+
+static void read_legacy_int(uint32_t key, uint8_t *value){
+  if(persist_exists(key)){
+    *value = persist_read_int(key);
+  }
+}
+
+static void read_legacy_bool(uint32_t key, bool *value){
+  if(persist_exists(key)){
+    *value = persist_read_bool(key);
+  }
+}
+
+static void migrate_legacy(Settings *settings){
+  read_legacy_int(KEY_SECOND_COLOR, &settings->seconds_color);
+  read_legacy_int(KEY_MINUTE_COLOR, &settings->minutes_color);
+  read_legacy_int(KEY_HOUR_COLOR, &settings->hours_color);
+  read_legacy_int(KEY_BT_LOGO_TYPE, &settings->bt_image_type);
+  read_legacy_int(KEY_TEMP_SCALE, &settings->temp_scale);
+  read_legacy_int(KEY_DATE_FORMAT, &settings->date_format);
+  read_legacy_bool(KEY_HIDE_SECONDS, &settings->hide_second_hand);
+  read_legacy_bool(KEY_SHOW_ANIMATION, &settings->show_animation);
+  read_legacy_int(KEY_WEATHER_MODE, &settings->weather_mode);
+  read_legacy_bool(KEY_SQUARE_FACE, &settings->square_face);
+  read_legacy_int(KEY_SECONDS_TIMEOUT, &settings->seconds_timeout);
+}
+
+static void delete_legacy(){
+  for(unsigned i = 0; i < ARRAY_LENGTH(LEGACY_KEYS); i++){
+    if(persist_exists(LEGACY_KEYS[i])){
+      persist_delete(LEGACY_KEYS[i]);
+      PROFILE_TALLY(PROFILE_FLASH_WRITES);
+    }
+  }
+}
+
+// Overlay the saved blob on settings, by its version: one from this version
+// or, shorter, an older one has the fields it knows about where they are
+// now. One from a newer version, left behind by a downgrade, may not, and is
+// ignored. Returns whether the blob is up to date and need not be rewritten
+static bool read_blob(Settings *settings){
+  Settings saved = *settings;
+  int length = persist_read_data(PERSIST_KEY_SETTINGS, &saved, sizeof(Settings));
+  if(length < 1 || saved.version > SETTINGS_VERSION){
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Settings version %d not supported, using defaults",
+            length < 1 ? -1 : (int)saved.version);
+    return false;
+  }
+  *settings = saved;
+  return length == sizeof(Settings) && saved.version == SETTINGS_VERSION;
+}
+
+void settings_load(Settings *settings){
+  set_defaults(settings);
+
+  bool migrated = false;
+  if(persist_exists(PERSIST_KEY_SETTINGS)){
+    // Anything but an up to date blob is rewritten in full below
+    if(read_blob(settings)){
+      s_saved = *settings;
+    }
+  }else{
+    migrate_legacy(settings);
+    migrated = true;
+  }
+
+  settings->version = SETTINGS_VERSION;
+  settings_save(settings);
+  // Only once the blob holds them, so a failed write leaves them to migrate
+  // again next time
+  if(migrated && persist_exists(PERSIST_KEY_SETTINGS)){
+    delete_legacy();
+  }
+}
+
+void settings_save(const Settings *settings){
+  if(memcmp(settings, &s_saved, sizeof(Settings)) == 0){
+    return;
+  }
+  persist_write_data(PERSIST_KEY_SETTINGS, settings, sizeof(Settings));
+  PROFILE_TALLY(PROFILE_FLASH_WRITES);
+  s_saved = *settings;
+}
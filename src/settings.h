@@ -0,0 +1,35 @@
+#pragma once
+
+#include <pebble.h>
+
+// User settings, persisted as one blob under PERSIST_KEY_SETTINGS.
+// Fields are append-only: a blob saved by an older version is shorter, so
+// the fields it lacks keep their defaults when it is read back. version only
+// changes with the layout of the fields it has, which settings_load then
+// branches on; a blob from a newer version is ignored.
+
+#define PERSIST_KEY_SETTINGS 100
+#define SETTINGS_VERSION 1
+
+typedef struct __attribute__((__packed__)) {
+  uint8_t version;
+  uint8_t seconds_color;
+  uint8_t minutes_color;
+  uint8_t hours_color;
+  uint8_t bt_image_type;
+  uint8_t temp_scale;
+  uint8_t date_format;
+  bool hide_second_hand;
+  bool show_animation;
+  uint8_t weather_mode;
+  bool square_face;
+  uint8_t seconds_timeout;
+  uint8_t theme;
+  bool sweep_seconds;
+} Settings;
+
+// Defaults, overlaid with the saved blob or, on first run after an upgrade,
+// the old one-key-per-setting values
+void settings_load(Settings *settings);
+// Write the blob, unless it matches what was last loaded or saved
+void settings_save(const Settings *settings);
@@ -0,0 +1,70 @@
+#include "state.h"
+
+static State s_state;
+static uint32_t s_changes;
+
+// Store a field and raise flag if it differs
+#define STATE_UPDATE(field, value, flag) do { \
+    if(s_state.field != (value)){ \
+      s_state.field = (value); \
+      s_changes |= (flag); \
+    } \
+  } while(0)
+
+void state_set_time(const struct tm *t){
+  STATE_UPDATE(hour_pos, (t->tm_hour % 12) * 6 + t->tm_min / 10, STATE_HANDS);
+  STATE_UPDATE(minute_pos, t->tm_min, STATE_HANDS);
+  STATE_UPDATE(second_pos, t->tm_sec * HAND_SECOND_SUBSTEPS, STATE_HANDS);
+  STATE_UPDATE(pm, t->tm_hour >= 12, STATE_PM);
+  STATE_UPDATE(day, t->tm_mday, STATE_DATE);
+  STATE_UPDATE(month, t->tm_mon + 1, STATE_DATE);
+  STATE_UPDATE(weekday, t->tm_wday, STATE_WEEKDAY);
+}
+
+void state_set_second_step(uint8_t step){
+  STATE_UPDATE(second_pos, s_state.second_pos - s_state.second_pos % HAND_SECOND_SUBSTEPS + step, STATE_HANDS);
+}
+
+void state_set_battery(BatteryChargeState charge){
+  // The gauge shows tenths
+  if(charge.charge_percent / 10 != s_state.charge / 10){
+    s_changes |= STATE_BATTERY;
+  }
+  s_state.charge = charge.charge_percent;
+  STATE_UPDATE(plugged, charge.is_plugged, STATE_BATTERY);
+  STATE_UPDATE(charging, charge.is_charging, STATE_BATTERY);
+}
+
+void state_set_bluetooth(bool connected){
+  STATE_UPDATE(bt_connected, connected, STATE_BLUETOOTH);
+}
+
+void state_set_temperature(int16_t celsius){
+  STATE_UPDATE(temperature, celsius, STATE_TEMPERATURE);
+  STATE_UPDATE(has_temperature, true, STATE_TEMPERATURE);
+}
+
+void state_clear_temperature(void){
+  STATE_UPDATE(has_temperature, false, STATE_TEMPERATURE);
+}
+
+void state_set_tap_display(bool shown){
+  STATE_UPDATE(tap_display, shown, STATE_TAP_DISPLAY);
+}
+
+void state_set_settings(const Settings *settings){
+  if(memcmp(&s_state.settings, settings, sizeof(Settings)) != 0){
+    s_state.settings = *settings;
+    s_changes |= STATE_SETTINGS;
+  }
+}
+
+const State *state_get(void){
+  return &s_state;
+}
+
+uint32_t state_take_changes(void){
+  uint32_t changes = s_changes;
+  s_changes = 0;
+  return changes;
+}
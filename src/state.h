@@ -0,0 +1,59 @@
+#pragma once
+
+#include <pebble.h>
+#include "settings.h"
+#include "hand_tables.h"
+
+// What the face shows, written by the service handlers. Each setter works
+// out which displayed values actually changed and raises their flags; the
+// renderer takes the flags and redraws only what depends on them, without
+// peeking at the services itself.
+
+typedef enum {
+  STATE_HANDS = 1 << 0,
+  STATE_PM = 1 << 1,
+  STATE_DATE = 1 << 2,
+  STATE_WEEKDAY = 1 << 3,
+  STATE_BATTERY = 1 << 4,
+  STATE_BLUETOOTH = 1 << 5,
+  STATE_TEMPERATURE = 1 << 6,
+  STATE_TAP_DISPLAY = 1 << 7,
+  STATE_SETTINGS = 1 << 8
+} StateFlag;
+
+typedef struct {
+  // Clock hand positions, in table steps
+  uint8_t hour_pos;
+  uint8_t minute_pos;
+  uint8_t second_pos;
+  bool pm;
+  uint8_t day;
+  uint8_t month;
+  uint8_t weekday;
+  // Charge in percent; only a new tenth counts as a change
+  uint8_t charge;
+  bool plugged;
+  bool charging;
+  bool bt_connected;
+  // Celsius, as sent by the phone
+  int16_t temperature;
+  bool has_temperature;
+  bool tap_display;
+  Settings settings;
+} State;
+
+// Sets the second hand to the first sub-step of the second
+void state_set_time(const struct tm *t);
+// Move the second hand to a sub-step within the current second
+void state_set_second_step(uint8_t step);
+void state_set_battery(BatteryChargeState charge);
+void state_set_bluetooth(bool connected);
+void state_set_temperature(int16_t celsius);
+// Nothing to show, as when weather is turned off
+void state_clear_temperature(void);
+void state_set_tap_display(bool shown);
+void state_set_settings(const Settings *settings);
+
+const State *state_get(void);
+// Flags raised since the last call
+uint32_t state_take_changes(void);
@@ -0,0 +1,94 @@
+#include "theme.h"
+#include "gbitmap_color_palette_manipulator.h"
+
+static const Theme THEMES[NUM_THEMES] = {
+  {GColorOxfordBlueARGB8, GColorWhiteARGB8, GColorPictonBlueARGB8, GColorCobaltBlueARGB8}, //CLASSIC
+  {GColorDarkGrayARGB8, GColorWhiteARGB8, GColorVeryLightBlueARGB8, GColorLibertyARGB8}, //SLATE
+  {GColorDarkGreenARGB8, GColorMintGreenARGB8, GColorScreaminGreenARGB8, GColorIslamicGreenARGB8}, //FOREST
+  {GColorBulgarianRoseARGB8, GColorRajahARGB8, GColorOrangeARGB8, GColorWindsorTanARGB8} //EMBER
+};
+
+// Only the background and the bluetooth icon are loaded at any time
+#define MAX_THEMED_BITMAPS 2
+// Largest palette, 4 bit
+#define MAX_PALETTE_SIZE 16
+
+typedef struct {
+  GBitmap *bitmap;
+  GColor original[MAX_PALETTE_SIZE];
+} ThemedBitmap;
+
+static ThemedBitmap s_bitmaps[MAX_THEMED_BITMAPS];
+static uint8_t s_theme = THEME_CLASSIC;
+
+// Restore the original palettes, then send them all through the theme
+static void apply(ThemedBitmap **themed, int num_themed){
+  const Theme *theme = &THEMES[s_theme];
+  GColor lut[GCOLOR_REMAP_SIZE];
+  gcolor_remap_init(lut);
+  gcolor_remap_set(lut, GColorOxfordBlue, (GColor){.argb = theme->cell});
+  gcolor_remap_set(lut, GColorWhite, (GColor){.argb = theme->marks});
+  gcolor_remap_set(lut, GColorPictonBlue, (GColor){.argb = theme->bt_light});
+  gcolor_remap_set(lut, GColorCobaltBlue, (GColor){.argb = theme->bt_dark});
+
+  GBitmap *bitmaps[MAX_THEMED_BITMAPS];
+  for(int i = 0; i < num_themed; i++){
+    bitmaps[i] = themed[i]->bitmap;
+    memcpy(gbitmap_get_palette(bitmaps[i]), themed[i]->original,
+           get_num_palette_colors(bitmaps[i]) * sizeof(GColor));
+  }
+  gbitmap_remap_colors(lut, bitmaps, num_themed);
+}
+
+void theme_set(uint8_t theme){
+  if(theme >= NUM_THEMES){
+    theme = THEME_CLASSIC;
+  }
+  if(theme == s_theme){
+    return;
+  }
+  s_theme = theme;
+
+  ThemedBitmap *themed[MAX_THEMED_BITMAPS];
+  int num_themed = 0;
+  for(int i = 0; i < MAX_THEMED_BITMAPS; i++){
+    if(s_bitmaps[i].bitmap != NULL){
+      themed[num_themed++] = &s_bitmaps[i];
+    }
+  }
+  apply(themed, num_themed);
+}
+
+const Theme *theme_get(void){
+  return &THEMES[s_theme];
+}
+
+GBitmap *theme_bitmap_create(HeapTag tag, uint32_t resource_id){
+  GBitmap *bitmap = heap_bitmap_create_with_resource(tag, resource_id);
+  if(bitmap == NULL || get_num_palette_colors(bitmap) == 0){
+    // Not palettized, shown as drawn. None of the face's resources are;
+    // theming one per pixel would need a copy of its pixels to restore
+    return bitmap;
+  }
+
+  for(int i = 0; i < MAX_THEMED_BITMAPS; i++){
+    if(s_bitmaps[i].bitmap == NULL){
+      s_bitmaps[i].bitmap = bitmap;
+      memcpy(s_bitmaps[i].original, gbitmap_get_palette(bitmap), get_num_palette_colors(bitmap) * sizeof(GColor));
+      ThemedBitmap *themed = &s_bitmaps[i];
+      apply(&themed, 1);
+      return bitmap;
+    }
+  }
+  APP_LOG(APP_LOG_LEVEL_WARNING, "No theme slot for resource %lu", (unsigned long)resource_id);
+  return bitmap;
+}
+
+void theme_bitmap_destroy(HeapTag tag, GBitmap *bitmap){
+  for(int i = 0; i < MAX_THEMED_BITMAPS; i++){
+    if(s_bitmaps[i].bitmap == bitmap){
+      s_bitmaps[i].bitmap = NULL;
+    }
+  }
+  heap_bitmap_destroy(tag, bitmap);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <pebble.h>
+#include "heap_budget.h"
+
+// Color themes. The images are drawn in a fixed set of source colors and
+// recolored at load by rewriting their palettes, so a theme costs no extra
+// resources. Themed bitmaps keep their original palette and are rewritten
+// in place when the theme changes rather than reloaded.
+
+typedef enum {
+  THEME_CLASSIC,
+  THEME_SLATE,
+  THEME_FOREST,
+  THEME_EMBER,
+  NUM_THEMES
+} ThemeId;
+
+// Colors as ARGB8, each replacing one source color of the images
+typedef struct {
+  uint8_t cell;     // unlit grid cells and digit backing, OxfordBlue
+  uint8_t marks;    // hour marks and text, White
+  uint8_t bt_light; // small bluetooth icon, PictonBlue
+  uint8_t bt_dark;  // large bluetooth icon, CobaltBlue
+} Theme;
+
+// Switch theme, rewriting the palette of every themed bitmap
+void theme_set(uint8_t theme);
+const Theme *theme_get(void);
+
+// Load a bitmap recolored for the current theme
+GBitmap *theme_bitmap_create(HeapTag tag, uint32_t resource_id);
+void theme_bitmap_destroy(HeapTag tag, GBitmap *bitmap);
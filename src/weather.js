@@ -1,75 +1,197 @@
-var xhrRequest = function (url, type, callback) {
-  var xhr = new XMLHttpRequest();
-  xhr.onload = function () {
-    callback(this.responseText);
-  };
-  xhr.open(type, url);
-  xhr.send();
-};
-
-function locationSuccess(pos) {
-  // Construct URL
-  var url = "http://api.openweathermap.org/data/2.5/weather?lat=" +
-      pos.coords.latitude + "&lon=" + pos.coords.longitude + "&APPID=32ad695b1e2dd77639a34cbe6f39432d";
-
-  // Send request to OpenWeatherMap
-  xhrRequest(url, 'GET', 
-    function(responseText) {
-      // responseText contains a JSON object with weather info
-      console.log(responseText);
-      var json = JSON.parse(responseText);
-
-      // Temperature in Kelvin requires adjustment
-      var temperature = Math.round(json.main.temp - 273.15);
-      console.log("Temperature is " + temperature);
-      
-      // Assemble dictionary using our keys
-      var dictionary = {
-        "isWeather": 1,
-        "KEY_TEMPERATURE": temperature
-      };
-
-      // Send to Pebble
-      Pebble.sendAppMessage(dictionary,
-        function(e) {
-          console.log("Weather info sent to Pebble successfully!");
-        },
-        function(e) {
-          console.log("Error sending weather info to Pebble!");
+// Weather for the watch. The last location fix is reused until the phone has
+// moved, readings are served from a short cache, concurrent watch requests
+// share one fetch and a slow fetch is aborted. Everything it touches is
+// passed in, so it can run against a stub server and mocked geolocation.
+var WEATHER_URL = 'http://api.openweathermap.org/data/2.5/weather';
+var WEATHER_APP_ID = '32ad695b1e2dd77639a34cbe6f39432d';
+
+function createWeatherService(deps) {
+  var geolocation = deps.geolocation;
+  var Xhr = deps.XMLHttpRequest;
+  var storage = deps.localStorage;
+  var now = deps.now || Date.now;
+  var setTimer = deps.setTimeout || setTimeout;
+  var clearTimer = deps.clearTimeout || clearTimeout;
+  var baseUrl = deps.baseUrl || WEATHER_URL;
+  // A reading younger than this is sent again rather than refetched
+  var ttlMs = deps.ttlMs || 10 * 60 * 1000;
+  var timeoutMs = deps.timeoutMs || 15000;
+  // Fixes closer than this to the cached one count as the same place
+  var moveMeters = deps.moveMeters || 1000;
+
+  // Callbacks waiting on the fetch in flight
+  var waiting = [];
+
+  function load(key) {
+    try {
+      return JSON.parse(storage.getItem(key));
+    } catch(e) {
+      return null;
+    }
+  }
+
+  function save(key, value) {
+    storage.setItem(key, JSON.stringify(value));
+  }
+
+  // Great-circle distance in meters
+  function distance(a, b) {
+    var rad = Math.PI / 180;
+    var dLat = (b.lat - a.lat) * rad;
+    var dLon = (b.lon - a.lon) * rad;
+    var h = Math.sin(dLat / 2) * Math.sin(dLat / 2) +
+        Math.cos(a.lat * rad) * Math.cos(b.lat * rad) * Math.sin(dLon / 2) * Math.sin(dLon / 2);
+    return 2 * 6371000 * Math.asin(Math.min(1, Math.sqrt(h)));
+  }
+
+  function finish(err, celsius) {
+    var callbacks = waiting;
+    waiting = [];
+    callbacks.forEach(function(callback) {
+      callback(err, celsius);
+    });
+  }
+
+  function fetchWeather(place) {
+    var url = baseUrl + '?lat=' + place.lat + '&lon=' + place.lon + '&APPID=' + WEATHER_APP_ID;
+    var xhr = new Xhr();
+    var done = false;
+
+    function settle(err, celsius) {
+      if(done) {
+        return;
+      }
+      done = true;
+      clearTimer(timer);
+      finish(err, celsius);
+    }
+
+    var timer = setTimer(function() {
+      settle('timed out');
+      xhr.abort();
+    }, timeoutMs);
+
+    xhr.onload = function() {
+      if(xhr.status !== 200) {
+        settle('HTTP ' + xhr.status);
+        return;
+      }
+      var celsius;
+      try {
+        // Temperature in Kelvin requires adjustment
+        celsius = Math.round(JSON.parse(xhr.responseText).main.temp - 273.15);
+      } catch(e) {
+        settle('bad response');
+        return;
+      }
+      if(isNaN(celsius)) {
+        settle('bad response');
+        return;
+      }
+      save('weather_reading', {celsius: celsius, time: now(), lat: place.lat, lon: place.lon});
+      settle(null, celsius);
+    };
+    xhr.onerror = function() {
+      settle('network error');
+    };
+    xhr.open('GET', url);
+    xhr.send();
+  }
+
+  // Fetch for the current fix, or the cached place if the phone has not moved
+  // away from it or no fix can be had
+  function locate() {
+    var cached = load('weather_location');
+    geolocation.getCurrentPosition(
+      function(pos) {
+        var place = {lat: pos.coords.latitude, lon: pos.coords.longitude};
+        if(cached && distance(cached, place) < moveMeters) {
+          place = cached;
+        } else {
+          save('weather_location', place);
         }
-      );
-    }      
-  );
-}
+        fetchWeather(place);
+      },
+      function(err) {
+        if(cached) {
+          fetchWeather(cached);
+        } else {
+          finish('no location');
+        }
+      },
+      {timeout: timeoutMs, maximumAge: ttlMs}
+    );
+  }
 
-function locationError(err) {
-  console.log("Error requesting location!");
-}
+  return {
+    // callback(err, celsius)
+    get: function(callback) {
+      var reading = load('weather_reading');
+      if(reading && now() - reading.time < ttlMs) {
+        callback(null, reading.celsius);
+        return;
+      }
 
-function getWeather() {
-  navigator.geolocation.getCurrentPosition(
-    locationSuccess,
-    locationError,
-    {timeout: 15000, maximumAge: 60000}
-  );
+      waiting.push(callback);
+      if(waiting.length === 1) {
+        locate();
+      }
+    }
+  };
 }
 
-// Listen for when the watchface is opened
-Pebble.addEventListener('ready', 
-  function(e) {
-    console.log("PebbleKit JS ready!");
+// PebbleKit JS concatenates every script into one; under node this file is
+// loaded by itself, for tools/host/weather_test.js
+if(typeof module !== 'undefined') {
+  module.exports = createWeatherService;
+}
 
-    // Get the initial weather
-    //getWeather();
+function sendWeather(err, temperature) {
+  if(err) {
+    console.log('Weather unavailable: ' + err);
+    return;
   }
-);
+  console.log('Temperature is ' + temperature);
 
-// Listen for when an AppMessage is received
-Pebble.addEventListener('appmessage',
-  function(e) {
-    console.log("AppMessage received!");
-    getWeather();
-  }                     
-);
+  // Assemble dictionary using our keys
+  var dictionary = {
+    'isWeather': 1,
+    'KEY_TEMPERATURE': temperature
+  };
+
+  // Send to Pebble
+  Pebble.sendAppMessage(dictionary,
+    function(e) {
+      console.log('Weather info sent to Pebble successfully!');
+    },
+    function(e) {
+      console.log('Error sending weather info to Pebble!');
+    }
+  );
+}
 
+// Only on the phone, where these globals exist
+if(typeof Pebble !== 'undefined' && typeof navigator !== 'undefined') {
+  var weatherService = createWeatherService({
+    geolocation: navigator.geolocation,
+    XMLHttpRequest: XMLHttpRequest,
+    localStorage: localStorage
+  });
 
+  // Listen for when the watchface is opened
+  Pebble.addEventListener('ready',
+    function(e) {
+      console.log('PebbleKit JS ready!');
+    }
+  );
+
+  // Anything from the watch but its settings report asks for weather
+  Pebble.addEventListener('appmessage',
+    function(e) {
+      if(e.payload && e.payload['KEY_CONFIG_PACKED']) {
+        return;
+      }
+      weatherService.get(sendWeather);
+    }
+  );
+}
@@ -0,0 +1,131 @@
+#include "weather_scheduler.h"
+#include "outbox.h"
+#include "profile.h"
+
+static bool s_wanted = false;
+static bool s_in_flight = false;
+static bool s_connected = false;
+static uint32_t s_backoff_ms = WEATHER_BACKOFF_MIN_MS;
+static AppTimer *s_timeout_timer;
+static AppTimer *s_retry_timer;
+
+typedef struct __attribute__((__packed__)) {
+  int16_t celsius;
+  uint32_t fetched_at;
+} WeatherReading;
+
+static WeatherReading s_reading;
+static bool s_have_reading = false;
+
+static void cancel_timer(AppTimer **timer){
+  if(*timer != NULL){
+    app_timer_cancel(*timer);
+    *timer = NULL;
+  }
+}
+
+static void timeout_callback(void *data);
+
+static void try_send(){
+  if(!s_wanted || s_in_flight || !s_connected || s_retry_timer != NULL){
+    return;
+  }
+  s_in_flight = true;
+  s_timeout_timer = app_timer_register(WEATHER_REPLY_TIMEOUT_MS, timeout_callback, NULL);
+  outbox_enqueue(OUTBOX_WEATHER_REQUEST);
+}
+
+static void retry_callback(void *data){
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  s_retry_timer = NULL;
+  try_send();
+}
+
+static void fail(){
+  s_in_flight = false;
+  cancel_timer(&s_timeout_timer);
+  if(!s_connected){
+    // Reconnecting retries straight away
+    return;
+  }
+
+  cancel_timer(&s_retry_timer);
+  s_retry_timer = app_timer_register(s_backoff_ms, retry_callback, NULL);
+  APP_LOG(APP_LOG_LEVEL_ERROR, "Weather request failed, retry in %lus", (unsigned long)(s_backoff_ms / 1000));
+  s_backoff_ms *= 2;
+  if(s_backoff_ms > WEATHER_BACKOFF_MAX_MS){
+    s_backoff_ms = WEATHER_BACKOFF_MAX_MS;
+  }
+}
+
+static void timeout_callback(void *data){
+  PROFILE_TALLY(PROFILE_WAKEUPS);
+  s_timeout_timer = NULL;
+  fail();
+}
+
+void weather_scheduler_init(void){
+  s_connected = bluetooth_connection_service_peek();
+  s_have_reading = persist_read_data(PERSIST_KEY_WEATHER, &s_reading, sizeof(s_reading)) == sizeof(s_reading);
+}
+
+void weather_scheduler_request(void){
+  s_wanted = true;
+  try_send();
+}
+
+void weather_scheduler_received(void){
+  s_wanted = false;
+  s_in_flight = false;
+  s_backoff_ms = WEATHER_BACKOFF_MIN_MS;
+  cancel_timer(&s_timeout_timer);
+  cancel_timer(&s_retry_timer);
+}
+
+void weather_scheduler_sent(bool sent){
+  // A delivered request stays in flight until the reply or the timeout
+  if(!sent && s_in_flight){
+    fail();
+  }
+}
+
+void weather_scheduler_connection(bool connected){
+  s_connected = connected;
+  if(connected){
+    s_backoff_ms = WEATHER_BACKOFF_MIN_MS;
+    cancel_timer(&s_retry_timer);
+    try_send();
+  }else{
+    // The reply cannot arrive any more; wait for the reconnect
+    cancel_timer(&s_retry_timer);
+    if(s_in_flight){
+      fail();
+    }
+  }
+}
+
+void weather_scheduler_store(int16_t celsius){
+  s_reading = (WeatherReading) {
+    .celsius = celsius,
+    .fetched_at = time(NULL)
+  };
+  s_have_reading = true;
+  persist_write_data(PERSIST_KEY_WEATHER, &s_reading, sizeof(s_reading));
+  PROFILE_TALLY(PROFILE_FLASH_WRITES);
+}
+
+bool weather_scheduler_last_reading(int16_t *celsius){
+  if(s_have_reading){
+    *celsius = s_reading.celsius;
+  }
+  return s_have_reading;
+}
+
+bool weather_scheduler_is_stale(uint32_t max_age_s){
+  if(!s_have_reading){
+    return true;
+  }
+  uint32_t now = time(NULL);
+  // A clock set backwards makes the reading look newer than now
+  return now < s_reading.fetched_at || now - s_reading.fetched_at >= max_age_s;
+}
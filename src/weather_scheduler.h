@@ -0,0 +1,31 @@
+#pragma once
+
+#include <pebble.h>
+
+// Weather fetches from the phone: one request in flight at a time with a
+// reply timeout, exponential backoff after a failure, nothing sent while the
+// phone is disconnected and an immediate retry when it comes back.
+// The last reading is persisted with its fetch time, so a relaunch can show
+// it straight away and only refetch once it is stale.
+
+#define PERSIST_KEY_WEATHER 101
+
+#define WEATHER_REPLY_TIMEOUT_MS (60 * 1000)
+#define WEATHER_BACKOFF_MIN_MS (15 * 1000)
+#define WEATHER_BACKOFF_MAX_MS (30 * 60 * 1000)
+
+void weather_scheduler_init(void);
+// Ask for fresh weather; repeated calls before the reply are coalesced
+void weather_scheduler_request(void);
+// A weather reply arrived
+void weather_scheduler_received(void);
+// Outcome of handing the request to the outbox
+void weather_scheduler_sent(bool sent);
+void weather_scheduler_connection(bool connected);
+
+// Persist a reading, in Celsius as sent by the phone, stamped with now
+void weather_scheduler_store(int16_t celsius);
+// Last stored reading, false if there never was one
+bool weather_scheduler_last_reading(int16_t *celsius);
+// True without a reading or when it is older than max_age_s
+bool weather_scheduler_is_stale(uint32_t max_age_s);
@@ -0,0 +1,44 @@
+"""Bundle the config page into the phone JS as a data: URL.
+
+Run by wscript at build time. config/index.html gets its slate stylesheet
+and script inlined and is base64 encoded into CONFIG_PAGE_URL, which
+src/config.js opens, so the page the phone shows is always the one built
+with the app. The web fonts are not inlined; the page falls back to the
+system sans serif.
+
+Usage: config_page.py [config dir] > config_page.js
+"""
+
+from __future__ import print_function
+
+import base64
+import io
+import os
+import sys
+
+STYLESHEET = "<link rel='stylesheet' type='text/css' href='css/slate.min.css'>"
+SCRIPT = "<script src='js/slate.min.js'></script>"
+
+
+def read(path):
+    with io.open(path, encoding='utf-8') as f:
+        return f.read()
+
+
+def generate(config_dir):
+    html = read(os.path.join(config_dir, 'index.html'))
+    css = read(os.path.join(config_dir, 'css', 'slate.min.css'))
+    js = read(os.path.join(config_dir, 'js', 'slate.min.js'))
+    for tag in (STYLESHEET, SCRIPT):
+        if tag not in html:
+            raise ValueError('config page no longer has ' + tag)
+    html = html.replace(STYLESHEET, '<style>' + css + '</style>')
+    html = html.replace(SCRIPT, '<script>' + js + '</script>')
+    encoded = base64.b64encode(html.encode('utf-8')).decode('ascii')
+    return ('// Generated by tools/config_page.py at build time, do not edit.\n'
+            "var CONFIG_PAGE_URL = 'data:text/html;charset=utf-8;base64,%s';\n" % encoded)
+
+
+if __name__ == '__main__':
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+    print(generate(sys.argv[1] if len(sys.argv) > 1 else os.path.join(root, 'config')), end='')
@@ -0,0 +1,265 @@
+"""Pre-rasterize every hand position into span tables.
+
+Run by wscript at build time. This is a port of createHand and the fixed
+point drawAliasLine from src/main.c, so the watch only has to replay spans:
+no trigonometry and no line math on the device.
+
+Each position is stored as the final (cell, shade) set of one hand,
+relative to the clock centre, as horizontal runs of equal shade packed
+into 16 bits (see HAND_SPAN in src/hand_tables.h). A position whose cells
+are an exact mirror or transpose of an already emitted position only
+stores the octant transform that maps onto it.
+"""
+
+from __future__ import print_function
+
+import math
+
+TRIG_MAX_RATIO = 0xffff
+TRIG_MAX_ANGLE = 0x10000
+
+AA_FRAC_BITS = 32
+AA_ONE = 1 << AA_FRAC_BITS
+HI_COLOR_THRESHOLD = 11744051 << 8
+MID_COLOR_THRESHOLD = 11744051 << 7
+LO_COLOR_THRESHOLD = 13421773 << 5
+NUM_SHADES = 3
+
+# Octant transforms, applied to a stored cell in this order on replay
+TRANSPOSE = 4
+FLIP_X = 1
+FLIP_Y = 2
+
+# Longest run a packed span can hold
+MAX_SPAN = 4
+
+# (name, positions, thick, length as a fraction of WIDTH / 2)
+HANDS = [
+    ('HAND_HOUR', 72, True, lambda half: half // 2),
+    ('HAND_MINUTE', 60, True, lambda half: half * 2 // 3),
+    # 60 seconds of HAND_SECOND_SUBSTEPS each, for the sweeping mode
+    ('HAND_SECOND', 240, False, lambda half: half * 5 // 6),
+]
+
+# Platform geometry, mirroring src/cell_grid.h and render_cells():
+# (define, WIDTH, HEIGHT, centre y shift, faces)
+PLATFORMS = [
+    ('PBL_RECT', 144 // 4, 168 // 4, 0, [False, True]),
+    ('PBL_ROUND', 180 // 4, 180 // 4, 1, [False]),
+]
+
+
+def trig(angle, fn):
+    # sin_lookup/cos_lookup resolution. The firmware reads a table instead,
+    # which may be one LSB off this; tools/host/hand_test checks that no hand
+    # tip moves for that
+    return int(math.floor(fn(2 * math.pi * angle / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO + 0.5))
+
+
+def c_div(a, b):
+    # C integer division, truncating toward zero
+    q = abs(a) // abs(b)
+    return q if (a < 0) == (b < 0) else -q
+
+
+def create_hand(angle, length, x, y, square_face):
+    sin = trig(angle, math.sin)
+    cos = trig(angle, math.cos)
+    corr = TRIG_MAX_RATIO
+    if square_face:
+        corr = abs(cos)
+        if corr * 1000 < TRIG_MAX_RATIO * 707:
+            corr = abs(sin)
+    return c_div(sin * length, corr) + x, c_div(-cos * length, corr) + y
+
+
+def round_significand(m, sticky):
+    shift = m.bit_length() - 24
+    if shift > 0:
+        half = 1 << (shift - 1)
+        rem = m & ((half << 1) - 1)
+        m >>= shift
+        if rem > half or (rem == half and (sticky or (m & 1))):
+            m += 1
+        m <<= shift
+    return m
+
+
+def fx_round(x):
+    if x == 0:
+        return 0
+    m = round_significand(abs(x), False)
+    return -m if x < 0 else m
+
+
+def fx_div(n, d):
+    if n == 0:
+        return 0
+    an = abs(n) << AA_FRAC_BITS
+    m = round_significand(an // d, (an % d) != 0)
+    return -m if n < 0 else m
+
+
+def ipart(x):
+    return -((-x) >> AA_FRAC_BITS) if x < 0 else x >> AA_FRAC_BITS
+
+
+def fpart(x):
+    return -((-x) & (AA_ONE - 1)) if x < 0 else x & (AA_ONE - 1)
+
+
+def coverage_shade(c):
+    if c > HI_COLOR_THRESHOLD:
+        return 0
+    elif c > MID_COLOR_THRESHOLD:
+        return 1
+    elif c > LO_COLOR_THRESHOLD:
+        return 2
+    return NUM_SHADES
+
+
+def draw_alias_line(x0, y0, x1, y1, thick):
+    """Return {(x, y): shade} as left in the grid by drawAliasLine."""
+    cells = {}
+
+    def plot(x, y, c):
+        shade = coverage_shade(c)
+        if shade < NUM_SHADES:
+            cells[(x & 0xff, y & 0xff)] = shade
+
+    steep = abs(y1 - y0) > abs(x1 - x0)
+    if steep:
+        x0, y0, x1, y1 = y0, x0, y1, x1
+    if x0 > x1:
+        x0, x1, y0, y1 = x1, x0, y1, y0
+
+    dx = x1 - x0
+    dy = y1 - y0
+    gradient = fx_div(dy, dx) if dx != 0 else 0
+    intery = y0 << AA_FRAC_BITS
+
+    for x in range(x0, x1 + 1):
+        ip = ipart(intery)
+        rf = AA_ONE - fpart(intery)
+        if steep:
+            if thick:
+                plot(ip - 1, x, rf // 2)
+                plot(ip, x, AA_ONE)
+            else:
+                plot(ip, x, rf)
+            plot(ip + 1, x, fpart(intery))
+        else:
+            if thick:
+                plot(x, ip - 1, rf // 2)
+                plot(x, ip, AA_ONE)
+            else:
+                plot(x, ip, rf)
+            plot(x, ip + 1, fpart(intery))
+        intery = fx_round(intery + gradient)
+
+    if steep:
+        plot(y1, x1, AA_ONE)
+    else:
+        plot(x1, y1, AA_ONE)
+    return cells
+
+
+def hand_cells(width, height, centre_shift, npos, thick, length, pos, square_face):
+    cx = width // 2
+    cy = width // 2 - 1 + centre_shift
+    ex, ey = create_hand(TRIG_MAX_ANGLE * pos // npos, length, cx, cy, square_face)
+    cells = draw_alias_line(cx, cy, ex & 0xff, ey & 0xff, thick)
+    # Cells that fall off the grid are never drawn
+    return dict(((x - cx, y - cy), s) for (x, y), s in cells.items()
+                if x < width and y < height)
+
+
+def apply_transform(cells, transform):
+    out = {}
+    for (x, y), s in cells.items():
+        if transform & TRANSPOSE:
+            x, y = y, x
+        if transform & FLIP_X:
+            x = -x
+        if transform & FLIP_Y:
+            y = -y
+        out[(x, y)] = s
+    return out
+
+
+def to_spans(cells):
+    spans = []
+    for (x, y) in sorted(cells, key=lambda c: (c[1], c[0])):
+        s = cells[(x, y)]
+        if (spans and spans[-1][1] == y and spans[-1][0] + spans[-1][2] == x and
+                spans[-1][3] == s and spans[-1][2] < MAX_SPAN):
+            spans[-1][2] += 1
+        else:
+            spans.append([x, y, 1, s])
+    return spans
+
+
+def build_table(width, height, centre_shift, npos, thick, length, square_face):
+    """Return (spans, positions) where positions are (first, count, transform)."""
+    spans = []
+    positions = []
+    emitted = []  # (cells, first, count) of stored positions
+    for pos in range(npos):
+        cells = hand_cells(width, height, centre_shift, npos, thick, length, pos, square_face)
+        match = None
+        for stored, first, count in emitted:
+            for transform in range(8):
+                if apply_transform(stored, transform) == cells:
+                    match = (first, count, transform)
+                    break
+            if match:
+                break
+        if match is None:
+            own = to_spans(cells)
+            match = (len(spans), len(own), 0)
+            emitted.append((cells, len(spans), len(own)))
+            spans.extend(own)
+        positions.append(match)
+    return spans, positions
+
+
+def generate():
+    out = []
+    out.append('// Generated by tools/hand_tables.py at build time, do not edit.')
+    out.append('#include "hand_tables.h"')
+    out.append('')
+    for i, (platform, width, height, centre_shift, faces) in enumerate(PLATFORMS):
+        out.append('#%s defined(%s)' % ('if' if i == 0 else 'elif', platform))
+        names = {}
+        for face in faces:
+            face_name = 'square' if face else 'round'
+            for hand, npos, thick, length in HANDS:
+                spans, positions = build_table(width, height, centre_shift, npos, thick,
+                                               length(width // 2), face)
+                name = '%s_%s' % (hand.lower(), face_name)
+                names[(face, hand)] = name
+                out.append('static const HandSpan %s_spans[] = {' % name)
+                for x, y, n, s in spans:
+                    out.append('  HAND_SPAN(%d, %d, %d, %d),' % (x, y, n, s))
+                out.append('};')
+                out.append('static const HandPosition %s_positions[%d] = {' % (name, npos))
+                for first, count, transform in positions:
+                    out.append('  {%d, %d, %d},' % (first, count, transform))
+                out.append('};')
+                out.append('')
+        out.append('const HandTable HAND_TABLES[NUM_HAND_FACES][NUM_HANDS] = {')
+        for face in (False, True):
+            key_face = face if face in faces else False
+            entries = []
+            for hand, npos, thick, length in HANDS:
+                name = names[(key_face, hand)]
+                entries.append('{%s_positions, %s_spans}' % (name, name))
+            out.append('  {%s},' % ', '.join(entries))
+        out.append('};')
+    out.append('#endif')
+    out.append('')
+    return '\n'.join(out)
+
+
+if __name__ == '__main__':
+    print(generate(), end='')
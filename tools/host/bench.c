@@ -0,0 +1,74 @@
+#include "runtime.h"
+#include "settings.h"
+
+// Render benchmark: runs the face through every second of a 12 hour dial,
+// 43200 frames, and prints one CSV row per face:
+//   platform,face,frames,ns_per_frame,cells_per_frame,fill_calls_per_frame
+// With "frames" after the face, also a row per frame:
+//   frame,platform,face,hh:mm:ss,ns,cells,fill_calls
+//
+// Usage: bench square|round [frames]
+
+#define DIAL_SECONDS (12 * 60 * 60)
+
+#if defined(PBL_ROUND)
+#define PLATFORM "chalk"
+#else
+#define PLATFORM "basalt"
+#endif
+
+static const char *s_face;
+static bool s_per_frame;
+
+static void run(void){
+  HostStats start = host_stats;
+  uint64_t first = host_clock() / 1000 + 1;
+
+  for(uint64_t t = first; t < first + DIAL_SECONDS; t++){
+    HostStats before = host_stats;
+    host_run_until(t * 1000);
+    if(s_per_frame){
+      printf("frame,%s,%s,%02d:%02d:%02d,%llu,%u,%u\n", PLATFORM, s_face,
+             (int)(t / 3600 % 12), (int)(t / 60 % 60), (int)(t % 60),
+             (unsigned long long)(host_stats.app_ns - before.app_ns),
+             host_stats.cells_painted - before.cells_painted, host_stats.fill_calls - before.fill_calls);
+    }
+  }
+
+  uint32_t frames = host_stats.redraws - start.redraws;
+  if(frames == 0){
+    fprintf(stderr, "bench: no frames drawn\n");
+    exit(1);
+  }
+  printf("%s,%s,%u,%.0f,%.2f,%.2f\n", PLATFORM, s_face, frames,
+         (double)(host_stats.app_ns - start.app_ns) / frames,
+         (double)(host_stats.cells_painted - start.cells_painted) / frames,
+         (double)(host_stats.fill_calls - start.fill_calls) / frames);
+}
+
+int main(int argc, char **argv){
+  if(argc < 2 || (strcmp(argv[1], "square") != 0 && strcmp(argv[1], "round") != 0)){
+    fprintf(stderr, "usage: %s square|round [frames]\n", argv[0]);
+    return 2;
+  }
+  s_face = argv[1];
+  s_per_frame = argc > 2 && strcmp(argv[2], "frames") == 0;
+
+  // One second before the dial starts over, so the ticks cover all of it
+  host_set_clock((uint64_t)(DIAL_SECONDS - 1) * 1000);
+
+  // Hands only: no intro, no weather, ticking seconds that never idle
+  Settings settings;
+  settings_load(&settings);
+  settings.show_animation = false;
+  settings.weather_mode = 0;
+  settings.seconds_timeout = 0;
+  settings.hide_second_hand = false;
+  settings.sweep_seconds = false;
+  settings.square_face = strcmp(s_face, "square") == 0;
+  settings_save(&settings);
+
+  host_set_scenario(run);
+  watchface_main();
+  return 0;
+}
@@ -0,0 +1,301 @@
+// Tests of the config page as the phone serves it: src/config.js opens the
+// data: URL that tools/config_page.py builds, the page's own script runs
+// against a fake DOM built from its selects and checkboxes, and what it
+// submits goes back through config.js to a fake Pebble.sendAppMessage.
+//
+// Usage: node config_test.js <config_page.js>
+
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+var vm = require('vm');
+
+var CONFIG_JS = fs.readFileSync(path.join(__dirname, '../../src/config.js'), 'utf8');
+var CONFIG_PAGE_JS = fs.readFileSync(process.argv[2], 'utf8');
+
+function memoryStorage() {
+  var items = {};
+  return {
+    getItem: function(key) {
+      return key in items ? items[key] : null;
+    },
+    setItem: function(key, value) {
+      items[key] = String(value);
+    },
+    removeItem: function(key) {
+      delete items[key];
+    }
+  };
+}
+
+// The phone side: config.js with its Pebble events and what it sent. A
+// relaunch is a new phone on the same storage
+function phone(storage) {
+  var listeners = {};
+  var phone = {
+    storage: storage || memoryStorage(),
+    opened: null,
+    sent: []
+  };
+  var Pebble = {
+    addEventListener: function(name, fn) {
+      listeners[name] = fn;
+    },
+    openURL: function(url) {
+      phone.opened = url;
+    },
+    sendAppMessage: function(dict, success) {
+      phone.sent.push(dict);
+      success();
+    }
+  };
+  var context = vm.createContext({
+    Pebble: Pebble,
+    localStorage: phone.storage,
+    console: {log: function() {}}
+  });
+  vm.runInContext(CONFIG_PAGE_JS, context);
+  vm.runInContext(CONFIG_JS, context);
+  phone.emit = function(name, e) {
+    listeners[name](e || {});
+  };
+  return phone;
+}
+
+function select(html) {
+  var options = [];
+  var selectedIndex = 0;
+  var re = /<option[^>]*value="([^"]*)"([^>]*)>/g;
+  var m;
+  while((m = re.exec(html))) {
+    if(/\bselected\b/.test(m[2])) {
+      selectedIndex = options.length;
+    }
+    options.push({value: m[1]});
+  }
+  return {
+    options: options,
+    selectedIndex: selectedIndex,
+    get value() {
+      return options[this.selectedIndex].value;
+    },
+    set value(v) {
+      this.selectedIndex = options.map(function(o) {
+        return o.value;
+      }).indexOf(String(v));
+    }
+  };
+}
+
+// The page as a browser would load it from the URL config.js opened
+function page(url) {
+  var hash = url.indexOf('#') < 0 ? '' : url.substring(url.indexOf('#'));
+  var prefix = 'data:text/html;charset=utf-8;base64,';
+  assert.strictEqual(url.indexOf(prefix), 0, 'not the bundled page');
+  var html = Buffer.from(url.substring(prefix.length, url.length - hash.length), 'base64').toString('utf8');
+
+  var elements = {};
+  var re = /<select id="([^"]*)"[\s\S]*?<\/select>/g;
+  var m;
+  while((m = re.exec(html))) {
+    elements[m[1]] = select(m[0]);
+  }
+  re = /<input id='([^']*)' type='(checkbox|button)'/g;
+  while((m = re.exec(html))) {
+    elements[m[1]] = {
+      checked: false,
+      addEventListener: function(name, fn) {
+        this.click = fn;
+      }
+    };
+  }
+
+  var scripts = html.match(/<script>[\s\S]*?<\/script>/g);
+  var script = scripts[scripts.length - 1].replace(/^<script>|<\/script>$/g, '');
+  var document = {
+    getElementById: function(id) {
+      return elements[id];
+    }
+  };
+  vm.runInNewContext(script, {
+    document: document,
+    location: {search: '', hash: hash},
+    console: {log: function() {}}
+  }, {filename: 'config/index.html'});
+
+  return {
+    elements: elements,
+    // Submit and return what the page hands back to config.js
+    submit: function() {
+      elements['submit_button'].click();
+      var closed = 'pebblejs://close#';
+      assert.strictEqual(document.location.indexOf(closed), 0);
+      return document.location.substring(closed.length);
+    }
+  };
+}
+
+// What the watch reports on launch: the page's defaults, with changes
+function report(changes) {
+  var held = {3: 0, 4: 0, 5: 1, 6: 1, 7: 0, 8: 0, 9: 1, 10: 0, 11: 0, 12: 0, 13: 0, 15: 0, 17: 0};
+  for(var key in changes) {
+    held[key] = changes[key];
+  }
+  var packed = [1];
+  for(key in held) {
+    packed.push(Number(key), held[key]);
+  }
+  return {payload: {'KEY_CONFIG_PACKED': packed}};
+}
+
+// Open the page, change fields, submit
+function configure(p, fields) {
+  p.emit('showConfiguration');
+  var opened = page(p.opened);
+  for(var id in fields) {
+    if('checked' in opened.elements[id]) {
+      opened.elements[id].checked = fields[id];
+    } else {
+      opened.elements[id].value = fields[id];
+    }
+  }
+  p.emit('webviewclosed', {response: opened.submit()});
+}
+
+// Pairs of watch key and value from a packed config tuple
+function pairs(dict) {
+  var packed = dict['KEY_CONFIG_PACKED'];
+  var result = {};
+  for(var i = 1; i < packed.length; i += 2) {
+    result[packed[i]] = packed[i + 1];
+  }
+  return result;
+}
+
+var tests = [
+  ['the page is the bundled one and its defaults all reach the watch', function() {
+    var p = phone();
+    p.emit('ready');
+    p.emit('showConfiguration');
+    p.emit('webviewclosed', {response: page(p.opened).submit()});
+    assert.strictEqual(p.sent.length, 1);
+    assert.deepStrictEqual(pairs(p.sent[0]), {
+      3: 0, 4: 0, 5: 1, 6: 1, 7: 0, 13: 0, 15: 0, 17: 0
+    });
+  }],
+
+  ['the seconds timeout goes to the watch and comes back to the page', function() {
+    var p = phone();
+    p.emit('ready');
+    p.emit('showConfiguration');
+    var first = page(p.opened);
+    first.elements['seconds_timeout_select'].value = '5';
+    first.elements['hide_seconds_checkbox'].checked = true;
+    first.elements['hour_select'].value = '3';
+    p.emit('webviewclosed', {response: first.submit()});
+    assert.deepStrictEqual(pairs(p.sent[0])[13], 5);
+    assert.deepStrictEqual(pairs(p.sent[0])[7], 1);
+
+    p.emit('showConfiguration');
+    var second = page(p.opened);
+    assert.strictEqual(second.elements['seconds_timeout_select'].value, '5');
+    assert.strictEqual(second.elements['hide_seconds_checkbox'].checked, true);
+    assert.strictEqual(second.elements['hour_select'].value, '3');
+  }],
+
+  ['the theme goes to the watch alone and comes back to the page', function() {
+    var p = phone();
+    p.emit('ready');
+    p.emit('showConfiguration');
+    p.emit('webviewclosed', {response: page(p.opened).submit()});
+
+    p.emit('showConfiguration');
+    var first = page(p.opened);
+    first.elements['theme_select'].value = '2';
+    p.emit('webviewclosed', {response: first.submit()});
+    assert.strictEqual(p.sent.length, 2);
+    assert.deepStrictEqual(pairs(p.sent[1]), {15: 2});
+
+    p.emit('showConfiguration');
+    assert.strictEqual(page(p.opened).elements['theme_select'].value, '2');
+  }],
+
+  ['sweep seconds goes to the watch and comes back to the page', function() {
+    var p = phone();
+    p.emit('ready');
+    p.emit('showConfiguration');
+    var first = page(p.opened);
+    first.elements['sweep_seconds_checkbox'].checked = true;
+    p.emit('webviewclosed', {response: first.submit()});
+    assert.strictEqual(pairs(p.sent[0])[17], 1);
+
+    p.emit('showConfiguration');
+    var second = page(p.opened);
+    assert.strictEqual(second.elements['sweep_seconds_checkbox'].checked, true);
+    second.elements['sweep_seconds_checkbox'].checked = false;
+    p.emit('webviewclosed', {response: second.submit()});
+    assert.deepStrictEqual(pairs(p.sent[1]), {17: 0});
+  }],
+
+  ['a push sends only what the watch reported it lacks', function() {
+    var p = phone();
+    p.emit('ready');
+    p.emit('appmessage', report({}));
+    configure(p, {'hour_select': '3'});
+    assert.strictEqual(p.sent.length, 1);
+    assert.deepStrictEqual(pairs(p.sent[0]), {3: 3});
+  }],
+
+  ['what the watch acked outlives a relaunch', function() {
+    var first = phone();
+    first.emit('ready');
+    first.emit('appmessage', report({}));
+    configure(first, {'hour_select': '3'});
+
+    var second = phone(first.storage);
+    second.emit('ready');
+    configure(second, {'theme_select': '2'});
+    assert.strictEqual(second.sent.length, 1);
+    assert.deepStrictEqual(pairs(second.sent[0]), {15: 2});
+  }],
+
+  ['a reset watch gets back everything it lost', function() {
+    var first = phone();
+    first.emit('ready');
+    first.emit('appmessage', report({}));
+    configure(first, {'hour_select': '3', 'theme_select': '2'});
+
+    var second = phone(first.storage);
+    second.emit('ready');
+    second.emit('appmessage', report({}));
+    configure(second, {'minute_select': '4'});
+    assert.deepStrictEqual(pairs(second.sent[0]), {3: 3, 4: 4, 15: 2});
+  }],
+
+  ['a report in another schema version forgets what was acked', function() {
+    var first = phone();
+    first.emit('ready');
+    first.emit('appmessage', report({}));
+    configure(first, {'hour_select': '3'});
+
+    var second = phone(first.storage);
+    second.emit('ready');
+    second.emit('appmessage', {payload: {'KEY_CONFIG_PACKED': [2, 3, 3]}});
+    configure(second, {});
+    assert.deepStrictEqual(pairs(second.sent[0]), {
+      3: 3, 4: 0, 5: 1, 6: 1, 7: 0, 13: 0, 15: 0, 17: 0
+    });
+  }]
+];
+
+var failures = 0;
+tests.forEach(function(test) {
+  try {
+    test[1]();
+    console.log('config,' + test[0] + ',ok');
+  } catch(e) {
+    console.log('config,' + test[0] + ',FAILED: ' + e.message);
+    failures++;
+  }
+});
+process.exitCode = failures === 0 ? 0 : 1;
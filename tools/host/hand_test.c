@@ -0,0 +1,255 @@
+// Equivalence test of the hand tables against the float rasterizer they
+// replaced: every position of every hand, on every face of the platform,
+// must light the same cells in the same shades. The reference below is
+// createHand and drawAliasLine as they were in src/main.c, float math and
+// all; the tables are replayed through main.c's own draw_hand and the cell
+// grid, and read back from the framebuffer. Each line ends with the count of
+// mismatching positions, then of positions that sin_lookup being off by one
+// on the watch could move (see trig_sensitive).
+//
+// Usage: hand_test
+
+#define main watchface_main
+#include "main.c"
+#undef main
+#include "runtime.h"
+
+#if defined(PBL_ROUND)
+#define PLATFORM "chalk"
+#else
+#define PLATFORM "basalt"
+#endif
+
+// Reference rasterizer
+
+static const float HI_COLOR_THRESHOLD = 0.7;
+static const float MID_COLOR_THRESHOLD = 0.35;
+static const float LO_COLOR_THRESHOLD = 0.1;
+
+// Shade plus one per cell, 0 where nothing is drawn
+static uint8_t s_expected[HEIGHT][WIDTH];
+
+static void plot(uint8_t x, uint8_t y, float c){
+  if(c <= LO_COLOR_THRESHOLD || x >= WIDTH || y >= HEIGHT){
+    return;
+  }
+  uint8_t shade = 2;
+  if(c > HI_COLOR_THRESHOLD){
+    shade = 0;
+  }else if(c > MID_COLOR_THRESHOLD){
+    shade = 1;
+  }
+  s_expected[y][x] = shade + 1;
+}
+
+static uint8_t ipart(float x){
+  return (uint8_t) x;
+}
+
+static float fpart(float x){
+  return x - (int)x;
+}
+
+static float rfpart(float x){
+  return 1.0 - fpart(x);
+}
+
+static void drawAliasLine(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, bool thick){
+  bool steep = abs(y1 - y0) > abs(x1 - x0);
+
+  if(steep){
+    swap(&x0, &y0);
+    swap(&x1, &y1);
+  }
+  if(x0 > x1){
+    swap(&x0, &x1);
+    swap(&y0, &y1);
+  }
+
+  int16_t dx = x1 - x0;
+  int16_t dy = y1 - y0;
+  float gradient = (float) dy / (float) dx;
+  float intery = y0;
+
+  for(uint8_t x = x0; x <= x1; x++){
+    if(steep){
+      if(thick){
+        plot(ipart(intery)-1, x, rfpart(intery)/2);
+        plot(ipart(intery), x, 1);
+      }else{
+        plot(ipart(intery), x, rfpart(intery));
+      }
+      plot(ipart(intery)+1, x, fpart(intery));
+    }else{
+      if(thick){
+        plot(x, ipart(intery)-1, rfpart(intery)/2);
+        plot(x, ipart(intery), 1);
+      }else{
+        plot(x, ipart(intery), rfpart(intery));
+      }
+      plot(x, ipart(intery)+1, fpart(intery));
+    }
+    intery = intery + gradient;
+  }
+
+  if(steep){
+    plot(y1, x1, 1);
+  }else{
+    plot(x1, y1, 1);
+  }
+}
+
+static GPoint hand_tip(int32_t sin, int32_t cos, int16_t length, int x, int y, bool square_face){
+  int32_t corr = TRIG_MAX_RATIO;
+
+  if(square_face){
+    corr = abs(cos);
+    if((float)corr/0.707 < TRIG_MAX_RATIO){
+      corr = abs(sin);
+    }
+  }
+
+  return (GPoint) {
+    .x = (int16_t)((sin * length)/corr) + x,
+    .y = (int16_t)((-cos * length)/corr) + y,
+  };
+}
+
+static GPoint createHand(int32_t angle, int16_t length, int x, int y, bool square_face){
+  return hand_tip(sin_lookup(angle), cos_lookup(angle), length, x, y, square_face);
+}
+
+// The tables and the reference both take sin and cos from libm, rounded to
+// TRIG_MAX_RATIO (see runtime.c), so agreeing with each other says nothing
+// about the firmware's sin_lookup table. That table is assumed to be within
+// one LSB of the rounded value, exact where the value is 0 or
+// +-TRIG_MAX_RATIO, and mirrored so that |sin| == |cos| on the diagonals.
+// Reports whether the hand tip moves when sin or cos is off by one LSB
+// either way: a tip that holds still draws the same line on the watch.
+static int32_t trig_slack(int32_t value){
+  return value == 0 || abs(value) == TRIG_MAX_RATIO ? 0 : 1;
+}
+
+static int32_t nudge(int32_t value, int32_t delta){
+  return value < 0 ? value - delta : value + delta;
+}
+
+static bool trig_sensitive(int32_t angle, int16_t length, int x, int y, bool square_face){
+  int32_t sin = sin_lookup(angle);
+  int32_t cos = cos_lookup(angle);
+  bool diagonal = abs(sin) == abs(cos);
+  GPoint tip = hand_tip(sin, cos, length, x, y, square_face);
+  for(int32_t ds = -trig_slack(sin); ds <= trig_slack(sin); ds++){
+    for(int32_t dc = -trig_slack(cos); dc <= trig_slack(cos); dc++){
+      if(diagonal && dc != ds){
+        continue;
+      }
+      GPoint moved = hand_tip(nudge(sin, ds), nudge(cos, dc), length, x, y, square_face);
+      if(moved.x != tip.x || moved.y != tip.y){
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// The test
+
+typedef struct {
+  const char *name;
+  uint8_t hand;
+  int positions;
+  bool thick;
+  int16_t length;
+} Hand;
+
+static const Hand HANDS[] = {
+  {"hour", HAND_HOUR, 72, true, (WIDTH / 2)/2},
+  {"minute", HAND_MINUTE, 60, true, (WIDTH / 2)*2/3},
+  {"second", HAND_SECOND, HAND_SECOND_POSITIONS, false, (WIDTH / 2)*5/6}
+};
+
+// Shade plus one of the cell drawn at x, y, from its top left pixel
+static uint8_t drawn_shade(GBitmap *fb, int16_t x, int16_t y){
+  GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y * RECTHEIGHT);
+  int16_t px = x * RECTWIDTH;
+  if(px < row.min_x || px > row.max_x || row.data[px] == GColorClearARGB8){
+    return 0;
+  }
+  for(uint8_t shade = 0; shade < 3; shade++){
+    if(row.data[px] == COLOR_SETS[WHITE][shade]){
+      return shade + 1;
+    }
+  }
+  return 0xff;
+}
+
+static int check_hand(const Hand *hand, bool square_face){
+  GPoint center = GPoint(WIDTH/2, WIDTH/2-1);
+  #if defined(PBL_ROUND)
+  center.y = center.y + 1;
+  #endif
+  GBitmap *fb = host_framebuffer();
+  int failures = 0;
+  int sensitive = 0;
+
+  for(int pos = 0; pos < hand->positions; pos++){
+    int32_t angle = TRIG_MAX_ANGLE * pos / hand->positions;
+    if(trig_sensitive(angle, hand->length, center.x, center.y, square_face)){
+      if(sensitive < 10){
+        printf("trig: %s %s hand, position %d moves with sin_lookup/cos_lookup off by one\n",
+               square_face ? "square" : "round", hand->name, pos);
+      }
+      sensitive++;
+    }
+    memset(s_expected, 0, sizeof(s_expected));
+    GPoint tip = createHand(angle, hand->length, center.x, center.y, square_face);
+    drawAliasLine(center.x, center.y, tip.x, tip.y, hand->thick);
+
+    for(int16_t y = 0; y < HOST_SCREEN_H; y++){
+      GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+      memset(row.data + row.min_x, GColorClearARGB8, row.max_x - row.min_x + 1);
+    }
+    cell_grid_clear();
+    draw_hand(hand->hand, pos, center, WHITE);
+    cell_grid_commit();
+    cell_grid_blit(host_context(), GRect(0, 0, WIDTH, HEIGHT), false);
+
+    for(int16_t y = 0; y < HEIGHT; y++){
+      for(int16_t x = 0; x < WIDTH; x++){
+        uint8_t drawn = drawn_shade(fb, x, y);
+        if(drawn != s_expected[y][x]){
+          if(failures < 10){
+            printf("mismatch: %s %s hand, position %d, cell %d,%d: shade %d, expected %d\n",
+                   square_face ? "square" : "round", hand->name, pos, x, y, drawn - 1, s_expected[y][x] - 1);
+          }
+          failures++;
+        }
+      }
+    }
+  }
+
+  printf("hands,%s,%s,%s,%d,%d,%d\n", PLATFORM, square_face ? "square" : "round", hand->name,
+         hand->positions, failures, sensitive);
+  return failures + sensitive;
+}
+
+int main(void){
+  // Just the under plane's clear cells around the hands
+  cell_grid_bake_begin(CELL_PLANE_UNDER);
+  cell_grid_bake_end();
+
+  int failures = 0;
+  for(int face = 0; face < 2; face++){
+    #if defined(PBL_ROUND)
+    if(face == 1){
+      break;
+    }
+    #endif
+    s_settings.square_face = face == 1;
+    for(unsigned i = 0; i < ARRAY_LENGTH(HANDS); i++){
+      failures += check_hand(&HANDS[i], s_settings.square_face);
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,380 @@
+#pragma once
+
+// Just enough of the Pebble SDK for the watchface sources to build and run on
+// the host, against the fake runtime in runtime.c. Only what src/ uses is
+// declared; behaviour follows the firmware where the face depends on it.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#define PBL_COLOR 1
+#if !defined(PBL_ROUND)
+#define PBL_RECT 1
+#endif
+
+// Geometry
+
+typedef struct GPoint { int16_t x, y; } GPoint;
+typedef struct GSize { int16_t w, h; } GSize;
+typedef struct GRect { GPoint origin; GSize size; } GRect;
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GSize(w, h) ((GSize){(w), (h)})
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+#define GRectZero GRect(0, 0, 0, 0)
+#define GPointZero GPoint(0, 0)
+bool grect_equal(const GRect *const r1, const GRect *const r2);
+
+// Colors
+
+typedef union GColor8 {
+  uint8_t argb;
+  struct { uint8_t b:2, g:2, r:2, a:2; };
+} GColor8;
+typedef GColor8 GColor;
+
+// Clear, then the 64 opaque colors as 0b11rrggbb
+#define GColorClearARGB8 0x00
+#define GColorBlackARGB8 0xC0
+#define GColorOxfordBlueARGB8 0xC1
+#define GColorDukeBlueARGB8 0xC2
+#define GColorBlueARGB8 0xC3
+#define GColorDarkGreenARGB8 0xC4
+#define GColorMidnightGreenARGB8 0xC5
+#define GColorCobaltBlueARGB8 0xC6
+#define GColorBlueMoonARGB8 0xC7
+#define GColorIslamicGreenARGB8 0xC8
+#define GColorJaegerGreenARGB8 0xC9
+#define GColorTiffanyBlueARGB8 0xCA
+#define GColorVividCeruleanARGB8 0xCB
+#define GColorGreenARGB8 0xCC
+#define GColorMalachiteARGB8 0xCD
+#define GColorMediumSpringGreenARGB8 0xCE
+#define GColorCyanARGB8 0xCF
+#define GColorBulgarianRoseARGB8 0xD0
+#define GColorImperialPurpleARGB8 0xD1
+#define GColorIndigoARGB8 0xD2
+#define GColorElectricUltramarineARGB8 0xD3
+#define GColorArmyGreenARGB8 0xD4
+#define GColorDarkGrayARGB8 0xD5
+#define GColorLibertyARGB8 0xD6
+#define GColorVeryLightBlueARGB8 0xD7
+#define GColorKellyGreenARGB8 0xD8
+#define GColorMayGreenARGB8 0xD9
+#define GColorCadetBlueARGB8 0xDA
+#define GColorPictonBlueARGB8 0xDB
+#define GColorBrightGreenARGB8 0xDC
+#define GColorScreaminGreenARGB8 0xDD
+#define GColorMediumAquamarineARGB8 0xDE
+#define GColorElectricBlueARGB8 0xDF
+#define GColorDarkCandyAppleRedARGB8 0xE0
+#define GColorJazzberryJamARGB8 0xE1
+#define GColorPurpleARGB8 0xE2
+#define GColorVividVioletARGB8 0xE3
+#define GColorWindsorTanARGB8 0xE4
+#define GColorRoseValeARGB8 0xE5
+#define GColorPurpureusARGB8 0xE6
+#define GColorLavenderIndigoARGB8 0xE7
+#define GColorLimerickARGB8 0xE8
+#define GColorBrassARGB8 0xE9
+#define GColorLightGrayARGB8 0xEA
+#define GColorBabyBlueEyesARGB8 0xEB
+#define GColorSpringBudARGB8 0xEC
+#define GColorInchwormARGB8 0xED
+#define GColorMintGreenARGB8 0xEE
+#define GColorCelesteARGB8 0xEF
+#define GColorRedARGB8 0xF0
+#define GColorFollyARGB8 0xF1
+#define GColorFashionMagentaARGB8 0xF2
+#define GColorMagentaARGB8 0xF3
+#define GColorOrangeARGB8 0xF4
+#define GColorSunsetOrangeARGB8 0xF5
+#define GColorBrilliantRoseARGB8 0xF6
+#define GColorShockingPinkARGB8 0xF7
+#define GColorChromeYellowARGB8 0xF8
+#define GColorRajahARGB8 0xF9
+#define GColorMelonARGB8 0xFA
+#define GColorRichBrilliantLavenderARGB8 0xFB
+#define GColorYellowARGB8 0xFC
+#define GColorIcterineARGB8 0xFD
+#define GColorPastelYellowARGB8 0xFE
+#define GColorWhiteARGB8 0xFF
+
+#define GColorFromARGB8(v) ((GColor8){.argb = (v)})
+#define GColorClear GColorFromARGB8(GColorClearARGB8)
+#define GColorBlack GColorFromARGB8(GColorBlackARGB8)
+#define GColorOxfordBlue GColorFromARGB8(GColorOxfordBlueARGB8)
+#define GColorDukeBlue GColorFromARGB8(GColorDukeBlueARGB8)
+#define GColorBlue GColorFromARGB8(GColorBlueARGB8)
+#define GColorDarkGreen GColorFromARGB8(GColorDarkGreenARGB8)
+#define GColorMidnightGreen GColorFromARGB8(GColorMidnightGreenARGB8)
+#define GColorCobaltBlue GColorFromARGB8(GColorCobaltBlueARGB8)
+#define GColorBlueMoon GColorFromARGB8(GColorBlueMoonARGB8)
+#define GColorIslamicGreen GColorFromARGB8(GColorIslamicGreenARGB8)
+#define GColorJaegerGreen GColorFromARGB8(GColorJaegerGreenARGB8)
+#define GColorTiffanyBlue GColorFromARGB8(GColorTiffanyBlueARGB8)
+#define GColorVividCerulean GColorFromARGB8(GColorVividCeruleanARGB8)
+#define GColorGreen GColorFromARGB8(GColorGreenARGB8)
+#define GColorMalachite GColorFromARGB8(GColorMalachiteARGB8)
+#define GColorMediumSpringGreen GColorFromARGB8(GColorMediumSpringGreenARGB8)
+#define GColorCyan GColorFromARGB8(GColorCyanARGB8)
+#define GColorBulgarianRose GColorFromARGB8(GColorBulgarianRoseARGB8)
+#define GColorImperialPurple GColorFromARGB8(GColorImperialPurpleARGB8)
+#define GColorIndigo GColorFromARGB8(GColorIndigoARGB8)
+#define GColorElectricUltramarine GColorFromARGB8(GColorElectricUltramarineARGB8)
+#define GColorArmyGreen GColorFromARGB8(GColorArmyGreenARGB8)
+#define GColorDarkGray GColorFromARGB8(GColorDarkGrayARGB8)
+#define GColorLiberty GColorFromARGB8(GColorLibertyARGB8)
+#define GColorVeryLightBlue GColorFromARGB8(GColorVeryLightBlueARGB8)
+#define GColorKellyGreen GColorFromARGB8(GColorKellyGreenARGB8)
+#define GColorMayGreen GColorFromARGB8(GColorMayGreenARGB8)
+#define GColorCadetBlue GColorFromARGB8(GColorCadetBlueARGB8)
+#define GColorPictonBlue GColorFromARGB8(GColorPictonBlueARGB8)
+#define GColorBrightGreen GColorFromARGB8(GColorBrightGreenARGB8)
+#define GColorScreaminGreen GColorFromARGB8(GColorScreaminGreenARGB8)
+#define GColorMediumAquamarine GColorFromARGB8(GColorMediumAquamarineARGB8)
+#define GColorElectricBlue GColorFromARGB8(GColorElectricBlueARGB8)
+#define GColorDarkCandyAppleRed GColorFromARGB8(GColorDarkCandyAppleRedARGB8)
+#define GColorJazzberryJam GColorFromARGB8(GColorJazzberryJamARGB8)
+#define GColorPurple GColorFromARGB8(GColorPurpleARGB8)
+#define GColorVividViolet GColorFromARGB8(GColorVividVioletARGB8)
+#define GColorWindsorTan GColorFromARGB8(GColorWindsorTanARGB8)
+#define GColorRoseVale GColorFromARGB8(GColorRoseValeARGB8)
+#define GColorPurpureus GColorFromARGB8(GColorPurpureusARGB8)
+#define GColorLavenderIndigo GColorFromARGB8(GColorLavenderIndigoARGB8)
+#define GColorLimerick GColorFromARGB8(GColorLimerickARGB8)
+#define GColorBrass GColorFromARGB8(GColorBrassARGB8)
+#define GColorLightGray GColorFromARGB8(GColorLightGrayARGB8)
+#define GColorBabyBlueEyes GColorFromARGB8(GColorBabyBlueEyesARGB8)
+#define GColorSpringBud GColorFromARGB8(GColorSpringBudARGB8)
+#define GColorInchworm GColorFromARGB8(GColorInchwormARGB8)
+#define GColorMintGreen GColorFromARGB8(GColorMintGreenARGB8)
+#define GColorCeleste GColorFromARGB8(GColorCelesteARGB8)
+#define GColorRed GColorFromARGB8(GColorRedARGB8)
+#define GColorFolly GColorFromARGB8(GColorFollyARGB8)
+#define GColorFashionMagenta GColorFromARGB8(GColorFashionMagentaARGB8)
+#define GColorMagenta GColorFromARGB8(GColorMagentaARGB8)
+#define GColorOrange GColorFromARGB8(GColorOrangeARGB8)
+#define GColorSunsetOrange GColorFromARGB8(GColorSunsetOrangeARGB8)
+#define GColorBrilliantRose GColorFromARGB8(GColorBrilliantRoseARGB8)
+#define GColorShockingPink GColorFromARGB8(GColorShockingPinkARGB8)
+#define GColorChromeYellow GColorFromARGB8(GColorChromeYellowARGB8)
+#define GColorRajah GColorFromARGB8(GColorRajahARGB8)
+#define GColorMelon GColorFromARGB8(GColorMelonARGB8)
+#define GColorRichBrilliantLavender GColorFromARGB8(GColorRichBrilliantLavenderARGB8)
+#define GColorYellow GColorFromARGB8(GColorYellowARGB8)
+#define GColorIcterine GColorFromARGB8(GColorIcterineARGB8)
+#define GColorPastelYellow GColorFromARGB8(GColorPastelYellowARGB8)
+#define GColorWhite GColorFromARGB8(GColorWhiteARGB8)
+
+static inline bool gcolor_equal(GColor a, GColor b){
+  return a.argb == b.argb;
+}
+
+// Graphics
+
+typedef struct GContext GContext;
+typedef struct GBitmap GBitmap;
+typedef enum { GCornerNone = 0 } GCornerMask;
+typedef enum { GCompOpAssign, GCompOpSet } GCompOp;
+typedef enum {
+  GBitmapFormat1Bit = 0,
+  GBitmapFormat8Bit,
+  GBitmapFormat1BitPalette,
+  GBitmapFormat2BitPalette,
+  GBitmapFormat4BitPalette,
+  GBitmapFormat8BitCircular
+} GBitmapFormat;
+typedef struct GBitmapDataRowInfo {
+  uint8_t *data;
+  int16_t min_x;
+  int16_t max_x;
+} GBitmapDataRowInfo;
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode);
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask);
+GBitmap *graphics_capture_frame_buffer(GContext *ctx);
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer);
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id);
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format);
+void gbitmap_destroy(GBitmap *bitmap);
+GRect gbitmap_get_bounds(const GBitmap *bitmap);
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap);
+GColor *gbitmap_get_palette(const GBitmap *bitmap);
+uint8_t *gbitmap_get_data(const GBitmap *bitmap);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap);
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y);
+
+#define TRIG_MAX_RATIO 0xffff
+#define TRIG_MAX_ANGLE 0x10000
+int32_t sin_lookup(int32_t angle);
+int32_t cos_lookup(int32_t angle);
+
+// Resources, as the SDK would generate them from appinfo.json
+#define RESOURCE_ID_BG_SQUARE 1
+#define RESOURCE_ID_BG_ROUND 2
+#define RESOURCE_ID_BT1 3
+#define RESOURCE_ID_BT2 4
+
+// Layers and windows
+
+typedef struct Layer Layer;
+typedef struct Window Window;
+typedef struct BitmapLayer BitmapLayer;
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+typedef void (*WindowHandler)(Window *window);
+typedef struct {
+  WindowHandler load;
+  WindowHandler appear;
+  WindowHandler disappear;
+  WindowHandler unload;
+} WindowHandlers;
+
+Layer *layer_create(GRect frame);
+void layer_destroy(Layer *layer);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc);
+void layer_add_child(Layer *parent, Layer *child);
+void layer_mark_dirty(Layer *layer);
+GRect layer_get_frame(const Layer *layer);
+GRect layer_get_bounds(const Layer *layer);
+void layer_set_frame(Layer *layer, GRect frame);
+void layer_set_bounds(Layer *layer, GRect bounds);
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer);
+
+Window *window_create(void);
+void window_destroy(Window *window);
+void window_set_window_handlers(Window *window, WindowHandlers handlers);
+void window_set_background_color(Window *window, GColor color);
+Layer *window_get_root_layer(const Window *window);
+void window_stack_push(Window *window, bool animated);
+
+// Event services and timers
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void *data);
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *data);
+bool app_timer_reschedule(AppTimer *timer, uint32_t new_timeout_ms);
+void app_timer_cancel(AppTimer *timer);
+
+typedef enum {
+  SECOND_UNIT = 1 << 0,
+  MINUTE_UNIT = 1 << 1,
+  HOUR_UNIT = 1 << 2,
+  DAY_UNIT = 1 << 3,
+  MONTH_UNIT = 1 << 4,
+  YEAR_UNIT = 1 << 5
+} TimeUnits;
+typedef void (*TickHandler)(struct tm *tick_time, TimeUnits units_changed);
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+
+// The virtual clock stands in for the C library's
+time_t host_time(time_t *t);
+#define time(t) host_time(t)
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms);
+
+typedef enum { ACCEL_AXIS_X, ACCEL_AXIS_Y, ACCEL_AXIS_Z } AccelAxisType;
+typedef void (*AccelTapHandler)(AccelAxisType axis, int32_t direction);
+void accel_tap_service_subscribe(AccelTapHandler handler);
+void accel_tap_service_unsubscribe(void);
+
+typedef struct {
+  uint8_t charge_percent;
+  bool is_charging;
+  bool is_plugged;
+} BatteryChargeState;
+typedef void (*BatteryStateHandler)(BatteryChargeState charge);
+BatteryChargeState battery_state_service_peek(void);
+void battery_state_service_subscribe(BatteryStateHandler handler);
+void battery_state_service_unsubscribe(void);
+
+typedef void (*BluetoothConnectionHandler)(bool connected);
+bool bluetooth_connection_service_peek(void);
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler);
+void bluetooth_connection_service_unsubscribe(void);
+
+void vibes_short_pulse(void);
+
+// AppMessage
+
+typedef enum {
+  APP_MSG_OK = 0,
+  APP_MSG_SEND_TIMEOUT = 1 << 1,
+  APP_MSG_NOT_CONNECTED = 1 << 3,
+  APP_MSG_BUSY = 1 << 6
+} AppMessageResult;
+typedef enum { DICT_OK = 0, DICT_NOT_ENOUGH_STORAGE = 1 << 1 } DictionaryResult;
+typedef enum { TUPLE_BYTE_ARRAY = 0, TUPLE_CSTRING = 1, TUPLE_UINT = 2, TUPLE_INT = 3 } TupleType;
+typedef struct __attribute__((__packed__)) Tuple {
+  uint32_t key;
+  TupleType type:8;
+  uint16_t length;
+  union {
+    uint8_t data[0];
+    char cstring[0];
+    uint8_t uint8;
+    uint16_t uint16;
+    uint32_t uint32;
+    int8_t int8;
+    int16_t int16;
+    int32_t int32;
+  } value[];
+} Tuple;
+typedef struct DictionaryIterator DictionaryIterator;
+typedef void (*AppMessageInboxReceived)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageInboxDropped)(AppMessageResult reason, void *context);
+typedef void (*AppMessageOutboxSent)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageOutboxFailed)(DictionaryIterator *iterator, AppMessageResult reason, void *context);
+
+AppMessageResult app_message_open(uint32_t size_inbound, uint32_t size_outbound);
+uint32_t app_message_inbox_size_maximum(void);
+uint32_t app_message_outbox_size_maximum(void);
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator);
+AppMessageResult app_message_outbox_send(void);
+void app_message_register_inbox_received(AppMessageInboxReceived callback);
+void app_message_register_inbox_dropped(AppMessageInboxDropped callback);
+void app_message_register_outbox_sent(AppMessageOutboxSent callback);
+void app_message_register_outbox_failed(AppMessageOutboxFailed callback);
+void app_message_deregister_callbacks(void);
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, uint32_t key, uint8_t value);
+DictionaryResult dict_write_data(DictionaryIterator *iter, uint32_t key, const uint8_t *data, uint16_t size);
+Tuple *dict_read_first(DictionaryIterator *iter);
+Tuple *dict_read_next(DictionaryIterator *iter);
+Tuple *dict_find(const DictionaryIterator *iter, uint32_t key);
+
+// Storage and memory
+
+#define PERSIST_DATA_MAX_LENGTH 256
+typedef enum { S_SUCCESS = 0, E_DOES_NOT_EXIST = -9 } StatusCode;
+bool persist_exists(uint32_t key);
+int32_t persist_read_int(uint32_t key);
+bool persist_read_bool(uint32_t key);
+int persist_read_data(uint32_t key, void *buffer, size_t buffer_size);
+int persist_write_data(uint32_t key, const void *data, size_t size);
+StatusCode persist_write_int(uint32_t key, int32_t value);
+StatusCode persist_write_bool(uint32_t key, bool value);
+StatusCode persist_delete(uint32_t key);
+
+size_t heap_bytes_used(void);
+size_t heap_bytes_free(void);
+
+// Logging and the app lifecycle
+
+typedef enum {
+  APP_LOG_LEVEL_ERROR = 1,
+  APP_LOG_LEVEL_WARNING = 50,
+  APP_LOG_LEVEL_INFO = 100,
+  APP_LOG_LEVEL_DEBUG = 200
+} AppLogLevel;
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...);
+#define APP_LOG(level, fmt, ...) app_log(level, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
+
+void app_event_loop(void);
+
+#define ARRAY_LENGTH(array) (sizeof((array)) / sizeof((array)[0]))
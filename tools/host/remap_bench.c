@@ -0,0 +1,165 @@
+#include "runtime.h"
+#include "gbitmap_color_palette_manipulator.h"
+
+// gbitmap_remap_colors, checked and timed.
+//
+// The check runs 8 bit bitmaps of many widths, padded rows and rows starting
+// at every alignment, and circular ones clipped to min_x..max_x per row,
+// through a scrambling lookup table, and compares every byte with a per
+// pixel reference: visible pixels remapped keeping their alpha, transparent
+// ones and everything outside the rows untouched.
+//
+// The benchmark then remaps a screen sized bitmap of each format and prints
+// one CSV row per format:
+//   format,bytes_per_call,ns_per_call,bytes_per_s
+// where the bytes are those remapped: palette entries for palettized
+// formats, pixels for 8 bit ones.
+//
+// Usage: remap_bench [check]
+
+#define BENCH_NS (200 * 1000 * 1000)
+
+static GColor s_lut[GCOLOR_REMAP_SIZE];
+
+static uint64_t wall_ns(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint8_t reference(uint8_t argb){
+  if((argb & 0xC0) == 0){
+    return argb;
+  }
+  return (argb & 0xC0) | (s_lut[argb & 0x3F].argb & 0x3F);
+}
+
+// Random bytes over the whole allocation the rows live in, from before the
+// first row to past the last
+static void fill(uint8_t *start, size_t length){
+  for(size_t i = 0; i < length; i++){
+    start[i] = rand();
+    // Plenty of fully transparent pixels and words
+    if(rand() % 3 == 0){
+      start[i] &= 0x3F;
+    }
+  }
+}
+
+static int check_bitmap(GBitmap *bitmap, uint8_t *start, size_t length, const char *name){
+  uint8_t *expected = malloc(length);
+  fill(start, length);
+  memcpy(expected, start, length);
+
+  GRect bounds = gbitmap_get_bounds(bitmap);
+  for(int16_t y = 0; y < bounds.size.h; y++){
+    GBitmapDataRowInfo row = gbitmap_get_data_row_info(bitmap, y);
+    for(int16_t x = row.min_x; x <= row.max_x && x < bounds.size.w; x++){
+      size_t i = row.data + x - start;
+      expected[i] = reference(expected[i]);
+    }
+  }
+  gbitmap_remap_colors(s_lut, &bitmap, 1);
+
+  int failures = 0;
+  for(size_t i = 0; i < length; i++){
+    if(start[i] != expected[i]){
+      if(failures == 0){
+        printf("mismatch: %s, byte %d: 0x%02x, expected 0x%02x\n", name, (int)i, start[i], expected[i]);
+      }
+      failures++;
+    }
+  }
+  free(expected);
+  return failures;
+}
+
+static int check(void){
+  static const int16_t WIDTHS[] = {1, 2, 3, 4, 5, 7, 8, 9, 13, 16, 17, 144};
+  static const int16_t PADDING[] = {0, 1, 3};
+  int failures = 0;
+  int cases = 0;
+  char name[64];
+
+  for(unsigned w = 0; w < ARRAY_LENGTH(WIDTHS); w++){
+    for(unsigned p = 0; p < ARRAY_LENGTH(PADDING); p++){
+      for(uint16_t offset = 0; offset < 4; offset++){
+        int16_t width = WIDTHS[w];
+        uint16_t row_size = width + PADDING[p];
+        GBitmap *bitmap = host_bitmap_create(GSize(width, 5), GBitmapFormat8Bit, row_size, offset);
+        uint8_t *data = gbitmap_get_data(bitmap);
+        snprintf(name, sizeof(name), "8 bit %dx5, row size %d, offset %d", width, row_size, offset);
+        failures += check_bitmap(bitmap, data - offset, offset + row_size * 5 + 8, name) != 0;
+        cases++;
+        gbitmap_destroy(bitmap);
+      }
+    }
+  }
+
+  // Packed rows, each starting wherever the previous ended
+  static const int16_t DIAMETERS[] = {7, 31, 180};
+  for(unsigned d = 0; d < ARRAY_LENGTH(DIAMETERS); d++){
+    int16_t size = DIAMETERS[d];
+    GBitmap *bitmap = host_bitmap_create(GSize(size, size), GBitmapFormat8BitCircular, 0, 0);
+    GBitmapDataRowInfo first = gbitmap_get_data_row_info(bitmap, 0);
+    GBitmapDataRowInfo last = gbitmap_get_data_row_info(bitmap, size - 1);
+    uint8_t *start = first.data + first.min_x;
+    snprintf(name, sizeof(name), "circular %dx%d", size, size);
+    failures += check_bitmap(bitmap, start, last.data + last.max_x + 1 - start, name) != 0;
+    cases++;
+    gbitmap_destroy(bitmap);
+  }
+
+  printf("remap_check,%d,%d\n", cases, failures);
+  return failures;
+}
+
+static void bench(const char *name, GBitmap *bitmap){
+  uint32_t bytes = get_num_palette_colors(bitmap);
+  if(bytes == 0){
+    GRect bounds = gbitmap_get_bounds(bitmap);
+    for(int16_t y = 0; y < bounds.size.h; y++){
+      GBitmapDataRowInfo row = gbitmap_get_data_row_info(bitmap, y);
+      bytes += row.max_x - row.min_x + 1;
+    }
+    GBitmapDataRowInfo first = gbitmap_get_data_row_info(bitmap, 0);
+    fill(first.data + first.min_x, bytes);
+  }
+
+  uint64_t calls = 0;
+  uint64_t start = wall_ns();
+  uint64_t elapsed;
+  do {
+    for(int i = 0; i < 100; i++){
+      gbitmap_remap_colors(s_lut, &bitmap, 1);
+    }
+    calls += 100;
+    elapsed = wall_ns() - start;
+  } while(elapsed < BENCH_NS);
+
+  printf("%s,%u,%.1f,%.0f\n", name, (unsigned)bytes, (double)elapsed / calls,
+         (double)bytes * calls * 1e9 / elapsed);
+}
+
+int main(int argc, char **argv){
+  srand(1);
+  // A permutation that moves every color, so a pixel remapped twice shows
+  for(int i = 0; i < GCOLOR_REMAP_SIZE; i++){
+    s_lut[i].argb = 0xC0 | ((i * 37 + 11) % GCOLOR_REMAP_SIZE);
+  }
+
+  if(check() != 0){
+    return 1;
+  }
+  if(argc > 1 && strcmp(argv[1], "check") == 0){
+    return 0;
+  }
+
+  GSize screen = GSize(HOST_SCREEN_W, HOST_SCREEN_H);
+  bench("1BitPalette", gbitmap_create_blank(screen, GBitmapFormat1BitPalette));
+  bench("2BitPalette", gbitmap_create_blank(screen, GBitmapFormat2BitPalette));
+  bench("4BitPalette", gbitmap_create_blank(screen, GBitmapFormat4BitPalette));
+  bench("8Bit", gbitmap_create_blank(screen, GBitmapFormat8Bit));
+  bench("8BitCircular", host_bitmap_create(GSize(180, 180), GBitmapFormat8BitCircular, 0, 0));
+  return 0;
+}
@@ -0,0 +1,148 @@
+"""Convert the face's bitmap resources for the host runtime.
+
+Run by the host Makefile. Like the SDK's resource build, each PNG listed in
+appinfo.json is reduced to the 64 color palette with 2 bit alpha and stored
+in the smallest palettized format that holds its colors; a file~platform.png
+variant wins over file.png for that platform. The output defines
+HOST_RESOURCES for both platforms, indexed by the RESOURCE_ID_* values in
+pebble.h.
+"""
+
+from __future__ import print_function
+
+import json
+import os
+import struct
+import sys
+import zlib
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..')
+
+# Resource ids as pebble.h numbers them
+RESOURCES = ['BG_SQUARE', 'BG_ROUND', 'BT1', 'BT2']
+
+# (define, SDK platform)
+PLATFORMS = [('PBL_ROUND', 'chalk'), ('PBL_RECT', 'basalt')]
+
+# (format, bits per pixel), smallest first
+FORMATS = [('GBitmapFormat1BitPalette', 1), ('GBitmapFormat2BitPalette', 2),
+           ('GBitmapFormat4BitPalette', 4)]
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def read_png(path):
+    """RGBA rows of an 8 bit, non-interlaced RGBA PNG."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    pos = 8
+    idat = b''
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += length + 12
+        if kind == b'IHDR':
+            width, height, depth, color_type, _, _, interlace = struct.unpack('>IIBBBBB', body)
+            if depth != 8 or color_type != 6 or interlace != 0:
+                raise ValueError('%s: only 8 bit RGBA PNGs are supported' % path)
+        elif kind == b'IDAT':
+            idat += body
+    raw = bytearray(zlib.decompress(idat))
+
+    stride = width * 4
+    prev = bytearray(stride)
+    rows = []
+    for y in range(height):
+        start = y * (stride + 1)
+        kind = raw[start]
+        line = raw[start + 1:start + 1 + stride]
+        for x in range(stride):
+            a = line[x - 4] if x >= 4 else 0
+            b = prev[x]
+            c = prev[x - 4] if x >= 4 else 0
+            if kind == 1:
+                line[x] = (line[x] + a) & 0xff
+            elif kind == 2:
+                line[x] = (line[x] + b) & 0xff
+            elif kind == 3:
+                line[x] = (line[x] + (a + b) // 2) & 0xff
+            elif kind == 4:
+                line[x] = (line[x] + paeth(a, b, c)) & 0xff
+        rows.append(line)
+        prev = line
+    return width, height, rows
+
+
+def to_argb8(r, g, b, a):
+    """Nearest GColor8, fully transparent pixels all as GColorClear."""
+    a = (a + 42) // 85
+    if a == 0:
+        return 0
+    return a << 6 | ((r + 42) // 85) << 4 | ((g + 42) // 85) << 2 | (b + 42) // 85
+
+
+def resource_files():
+    with open(os.path.join(ROOT, 'appinfo.json')) as f:
+        media = json.load(f)['resources']['media']
+    return dict((m['name'], m['file']) for m in media)
+
+
+def convert(path):
+    width, height, rows = read_png(path)
+    pixels = [[to_argb8(*row[4 * x:4 * x + 4]) for x in range(width)] for row in rows]
+    palette = sorted(set(p for row in pixels for p in row))
+    for fmt, bits in FORMATS:
+        if len(palette) <= 1 << bits:
+            break
+    else:
+        raise ValueError('%s: more than 16 colors' % path)
+
+    row_size = (width * bits + 7) // 8
+    data = []
+    for row in pixels:
+        packed = [0] * row_size
+        for x, p in enumerate(row):
+            shift = 8 - bits - (x * bits) % 8
+            packed[x * bits // 8] |= palette.index(p) << shift
+        data.extend(packed)
+    return width, height, fmt, row_size, palette, data
+
+
+def variant(path, platform):
+    base, ext = os.path.splitext(path)
+    tagged = '%s~%s%s' % (base, platform, ext)
+    return tagged if os.path.exists(tagged) else path
+
+
+def generate():
+    files = resource_files()
+    out = ['// Generated by tools/host/resources.py, do not edit', '', '#include "runtime.h"', '']
+    for i, (define, platform) in enumerate(PLATFORMS):
+        out.append('#if defined(%s)' % define if i == 0 else '#else')
+        entries = []
+        for name in RESOURCES:
+            path = variant(os.path.join(ROOT, 'resources', files[name]), platform)
+            width, height, fmt, row_size, palette, data = convert(path)
+            out.append('static const uint8_t %s_data[] = {' % name.lower())
+            for start in range(0, len(data), 16):
+                out.append('  %s,' % ', '.join('0x%02x' % b for b in data[start:start + 16]))
+            out.append('};')
+            entries.append('  [RESOURCE_ID_%s] = {{%d, %d}, %s, %d, {%s}, %d, %s_data},' % (
+                name, width, height, fmt, row_size, ', '.join('0x%02x' % p for p in palette),
+                len(palette), name.lower()))
+        out.append('const HostResource HOST_RESOURCES[HOST_NUM_RESOURCES] = {')
+        out.extend(entries)
+        out.append('};')
+    out.append('#endif')
+    out.append('')
+    return '\n'.join(out)
+
+
+if __name__ == '__main__':
+    sys.stdout.write(generate())
@@ -0,0 +1,1035 @@
+#include "runtime.h"
+#include "profile.h"
+#include <math.h>
+#include <stdarg.h>
+
+HostStats host_stats;
+
+static uint64_t s_now_ms;
+static HostScenario s_scenario;
+static HostPhone s_phone;
+
+static uint64_t wall_ns(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Heap, charged to the app like the firmware's app heap
+
+#define HOST_HEAP_SIZE (64 * 1024)
+
+typedef union {
+  size_t size;
+  max_align_t align;
+} HeapHeader;
+
+static size_t s_heap_used;
+
+static void *heap_alloc(size_t size){
+  HeapHeader *header = calloc(1, sizeof(HeapHeader) + size);
+  header->size = size;
+  s_heap_used += size;
+  return header + 1;
+}
+
+static void heap_free(void *ptr){
+  if(ptr == NULL){
+    return;
+  }
+  HeapHeader *header = (HeapHeader *)ptr - 1;
+  s_heap_used -= header->size;
+  free(header);
+}
+
+size_t heap_bytes_used(void){
+  return s_heap_used;
+}
+
+size_t heap_bytes_free(void){
+  return HOST_HEAP_SIZE - s_heap_used;
+}
+
+// Bitmaps
+
+#define MAX_BITMAP_ROWS 256
+
+struct GBitmap {
+  GBitmapFormat format;
+  GRect bounds;
+  uint16_t row_size;
+  uint8_t *data;
+  GColor palette[16];
+  bool on_heap;
+  // Circular bitmaps store only the visible part of each row, back to back
+  struct CircularRows *rows;
+};
+
+struct CircularRows {
+  uint32_t offset[MAX_BITMAP_ROWS];
+  int16_t min_x[MAX_BITMAP_ROWS];
+  int16_t max_x[MAX_BITMAP_ROWS];
+};
+
+// Visible pixels of a row of a round display of width w
+static void circle_row(int16_t w, int16_t h, int16_t y, int16_t *min_x, int16_t *max_x){
+  double r = w / 2.0;
+  double dy = y + 0.5 - h / 2.0;
+  double half = dy * dy < r * r ? sqrt(r * r - dy * dy) : 0;
+  *min_x = (int16_t)ceil(r - half - 0.5);
+  *max_x = w - 1 - *min_x;
+}
+
+static GBitmap *bitmap_create(GSize size, GBitmapFormat format, uint16_t row_size, uint16_t offset, bool on_heap){
+  if(size.h > MAX_BITMAP_ROWS){
+    return NULL;
+  }
+  size_t data_size = (size_t)row_size * size.h;
+  if(format == GBitmapFormat8BitCircular){
+    data_size = 0;
+    for(int16_t y = 0; y < size.h; y++){
+      int16_t min_x, max_x;
+      circle_row(size.w, size.h, y, &min_x, &max_x);
+      data_size += max_x - min_x + 1;
+    }
+  }
+
+  // Rows start offset bytes past a 16 byte boundary
+  size_t alloc_size = sizeof(GBitmap) + 16 + offset + data_size;
+  GBitmap *bitmap = on_heap ? heap_alloc(alloc_size) : calloc(1, alloc_size);
+  bitmap->format = format;
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+  bitmap->row_size = row_size;
+  bitmap->data = (uint8_t *)(((uintptr_t)(bitmap + 1) + 15) & ~(uintptr_t)15) + offset;
+  bitmap->on_heap = on_heap;
+
+  if(format == GBitmapFormat8BitCircular){
+    struct CircularRows *rows = calloc(1, sizeof(struct CircularRows));
+    uint32_t start = 0;
+    for(int16_t y = 0; y < size.h; y++){
+      circle_row(size.w, size.h, y, &rows->min_x[y], &rows->max_x[y]);
+      rows->offset[y] = start;
+      start += rows->max_x[y] - rows->min_x[y] + 1;
+    }
+    bitmap->rows = rows;
+  }
+  return bitmap;
+}
+
+GBitmap *host_bitmap_create(GSize size, GBitmapFormat format, uint16_t row_size, uint16_t offset){
+  return bitmap_create(size, format, row_size, offset, false);
+}
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format){
+  static const uint8_t BITS[] = {
+    [GBitmapFormat1Bit] = 1, [GBitmapFormat8Bit] = 8, [GBitmapFormat1BitPalette] = 1,
+    [GBitmapFormat2BitPalette] = 2, [GBitmapFormat4BitPalette] = 4, [GBitmapFormat8BitCircular] = 8
+  };
+  return bitmap_create(size, format, (size.w * BITS[format] + 7) / 8, 0, true);
+}
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id){
+  if(resource_id >= HOST_NUM_RESOURCES || HOST_RESOURCES[resource_id].data == NULL){
+    return NULL;
+  }
+  const HostResource *resource = &HOST_RESOURCES[resource_id];
+  GBitmap *bitmap = bitmap_create(resource->size, resource->format, resource->row_size, 0, true);
+  memcpy(bitmap->data, resource->data, (size_t)resource->row_size * resource->size.h);
+  for(int i = 0; i < resource->num_colors; i++){
+    bitmap->palette[i].argb = resource->palette[i];
+  }
+  host_stats.resource_loads++;
+  return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap){
+  if(bitmap == NULL){
+    return;
+  }
+  free(bitmap->rows);
+  if(bitmap->on_heap){
+    heap_free(bitmap);
+  }else{
+    free(bitmap);
+  }
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap){
+  return bitmap->bounds;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap){
+  return bitmap->format;
+}
+
+GColor *gbitmap_get_palette(const GBitmap *bitmap){
+  return (GColor *)bitmap->palette;
+}
+
+uint8_t *gbitmap_get_data(const GBitmap *bitmap){
+  return bitmap->data;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap){
+  return bitmap->format == GBitmapFormat8BitCircular ? 0 : bitmap->row_size;
+}
+
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y){
+  const struct CircularRows *rows = bitmap->rows;
+  if(rows == NULL){
+    return (GBitmapDataRowInfo) {
+      .data = bitmap->data + (uint32_t)y * bitmap->row_size,
+      .min_x = 0,
+      .max_x = bitmap->bounds.size.w - 1
+    };
+  }
+  // Indexed by x, though the row only holds min_x to max_x
+  return (GBitmapDataRowInfo) {
+    .data = bitmap->data + rows->offset[y] - rows->min_x[y],
+    .min_x = rows->min_x[y],
+    .max_x = rows->max_x[y]
+  };
+}
+
+// Drawing
+
+struct GContext {
+  // Screen position of the layer's bounds origin
+  GPoint offset;
+  // Screen rect drawing is limited to
+  GRect clip;
+  GColor fill;
+  GCompOp comp;
+};
+
+static GBitmap *s_framebuffer;
+static GContext s_ctx;
+
+static GRect screen_rect(void){
+  return GRect(0, 0, HOST_SCREEN_W, HOST_SCREEN_H);
+}
+
+GBitmap *host_framebuffer(void){
+  if(s_framebuffer == NULL){
+    #if defined(PBL_ROUND)
+    s_framebuffer = host_bitmap_create(GSize(HOST_SCREEN_W, HOST_SCREEN_H), GBitmapFormat8BitCircular, 0, 0);
+    #else
+    s_framebuffer = host_bitmap_create(GSize(HOST_SCREEN_W, HOST_SCREEN_H), GBitmapFormat8Bit, HOST_SCREEN_W, 0);
+    #endif
+  }
+  return s_framebuffer;
+}
+
+GContext *host_context(void){
+  s_ctx = (GContext) {
+    .offset = GPointZero,
+    .clip = screen_rect(),
+    .fill = GColorBlack,
+    .comp = GCompOpAssign
+  };
+  return &s_ctx;
+}
+
+static GRect intersect(GRect a, GRect b){
+  int16_t x0 = a.origin.x > b.origin.x ? a.origin.x : b.origin.x;
+  int16_t y0 = a.origin.y > b.origin.y ? a.origin.y : b.origin.y;
+  int16_t x1 = a.origin.x + a.size.w < b.origin.x + b.size.w ? a.origin.x + a.size.w : b.origin.x + b.size.w;
+  int16_t y1 = a.origin.y + a.size.h < b.origin.y + b.size.h ? a.origin.y + a.size.h : b.origin.y + b.size.h;
+  if(x1 <= x0 || y1 <= y0){
+    return GRectZero;
+  }
+  return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+bool grect_equal(const GRect *const r1, const GRect *const r2){
+  return r1->origin.x == r2->origin.x && r1->origin.y == r2->origin.y &&
+         r1->size.w == r2->size.w && r1->size.h == r2->size.h;
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color){
+  ctx->fill = color;
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode){
+  ctx->comp = mode;
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask){
+  if(ctx->fill.a == 0){
+    return;
+  }
+  rect.origin.x += ctx->offset.x;
+  rect.origin.y += ctx->offset.y;
+  rect = intersect(rect, ctx->clip);
+  GBitmap *fb = host_framebuffer();
+  for(int16_t y = rect.origin.y; y < rect.origin.y + rect.size.h; y++){
+    GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+    int16_t x0 = rect.origin.x > row.min_x ? rect.origin.x : row.min_x;
+    int16_t x1 = rect.origin.x + rect.size.w - 1 < row.max_x ? rect.origin.x + rect.size.w - 1 : row.max_x;
+    if(x0 <= x1){
+      memset(row.data + x0, ctx->fill.argb, x1 - x0 + 1);
+    }
+  }
+}
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx){
+  return host_framebuffer();
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer){
+  return true;
+}
+
+int32_t sin_lookup(int32_t angle){
+  return (int32_t)floor(sin(2 * M_PI * angle / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO + 0.5);
+}
+
+int32_t cos_lookup(int32_t angle){
+  return (int32_t)floor(cos(2 * M_PI * angle / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO + 0.5);
+}
+
+// Layers and windows
+
+struct Layer {
+  GRect frame;
+  GRect bounds;
+  LayerUpdateProc update_proc;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+};
+
+struct Window {
+  Layer root;
+  WindowHandlers handlers;
+  GColor background;
+  bool loaded;
+};
+
+static Window *s_top_window;
+static bool s_dirty;
+
+Layer *layer_create(GRect frame){
+  Layer *layer = heap_alloc(sizeof(Layer));
+  layer->frame = frame;
+  layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+  return layer;
+}
+
+void layer_destroy(Layer *layer){
+  if(layer == NULL){
+    return;
+  }
+  if(layer->parent != NULL){
+    Layer **link = &layer->parent->first_child;
+    while(*link != layer){
+      link = &(*link)->next_sibling;
+    }
+    *link = layer->next_sibling;
+  }
+  heap_free(layer);
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc){
+  layer->update_proc = update_proc;
+}
+
+void layer_add_child(Layer *parent, Layer *child){
+  Layer **link = &parent->first_child;
+  while(*link != NULL){
+    link = &(*link)->next_sibling;
+  }
+  *link = child;
+  child->parent = parent;
+  s_dirty = true;
+}
+
+void layer_mark_dirty(Layer *layer){
+  s_dirty = true;
+}
+
+GRect layer_get_frame(const Layer *layer){
+  return layer->frame;
+}
+
+GRect layer_get_bounds(const Layer *layer){
+  return layer->bounds;
+}
+
+// As on the watch, bounds that were the whole frame follow its size
+void layer_set_frame(Layer *layer, GRect frame){
+  GRect whole = GRect(0, 0, layer->frame.size.w, layer->frame.size.h);
+  if(grect_equal(&layer->bounds, &whole)){
+    layer->bounds.size = frame.size;
+  }
+  layer->frame = frame;
+}
+
+void layer_set_bounds(Layer *layer, GRect bounds){
+  layer->bounds = bounds;
+}
+
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer){
+  return (Layer *)bitmap_layer;
+}
+
+Window *window_create(void){
+  Window *window = heap_alloc(sizeof(Window));
+  window->root.frame = screen_rect();
+  window->root.bounds = screen_rect();
+  window->background = GColorWhite;
+  return window;
+}
+
+void window_destroy(Window *window){
+  if(window == s_top_window){
+    s_top_window = NULL;
+  }
+  if(window->loaded && window->handlers.unload != NULL){
+    window->handlers.unload(window);
+  }
+  heap_free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers){
+  window->handlers = handlers;
+}
+
+void window_set_background_color(Window *window, GColor color){
+  window->background = color;
+}
+
+Layer *window_get_root_layer(const Window *window){
+  return (Layer *)&window->root;
+}
+
+void window_stack_push(Window *window, bool animated){
+  s_top_window = window;
+  if(!window->loaded){
+    window->loaded = true;
+    if(window->handlers.load != NULL){
+      window->handlers.load(window);
+    }
+  }
+  if(window->handlers.appear != NULL){
+    window->handlers.appear(window);
+  }
+  s_dirty = true;
+}
+
+static void draw_layer(Layer *layer, GPoint parent_origin, GRect parent_clip){
+  GPoint origin = GPoint(parent_origin.x + layer->frame.origin.x, parent_origin.y + layer->frame.origin.y);
+  GRect clip = intersect(GRect(origin.x, origin.y, layer->frame.size.w, layer->frame.size.h), parent_clip);
+  if(clip.size.w == 0){
+    return;
+  }
+  GPoint content = GPoint(origin.x + layer->bounds.origin.x, origin.y + layer->bounds.origin.y);
+  if(layer->update_proc != NULL){
+    s_ctx = (GContext) {
+      .offset = content,
+      .clip = clip,
+      .fill = GColorBlack,
+      .comp = GCompOpAssign
+    };
+    layer->update_proc(layer, &s_ctx);
+  }
+  for(Layer *child = layer->first_child; child != NULL; child = child->next_sibling){
+    draw_layer(child, content, clip);
+  }
+}
+
+// Draw a frame if anything was marked dirty, as the firmware does once an
+// event has been handled
+static void render(void){
+  if(!s_dirty || s_top_window == NULL){
+    return;
+  }
+  s_dirty = false;
+  host_stats.redraws++;
+  uint64_t start = wall_ns();
+  GContext *ctx = host_context();
+  ctx->fill = s_top_window->background;
+  graphics_fill_rect(ctx, screen_rect(), 0, GCornerNone);
+  draw_layer(&s_top_window->root, GPointZero, screen_rect());
+  host_stats.app_ns += wall_ns() - start;
+}
+
+// Every callback into the app is a wakeup, and is followed by a frame
+static uint64_t s_app_start;
+
+static void app_enter(void){
+  host_stats.wakeups++;
+  s_app_start = wall_ns();
+}
+
+static void app_leave(void){
+  host_stats.app_ns += wall_ns() - s_app_start;
+  render();
+}
+
+// Timers, app ones and the runtime's own events
+
+#define MAX_TIMERS 32
+
+struct AppTimer {
+  bool used;
+  bool app;
+  uint64_t due;
+  // Orders timers due at the same time
+  uint32_t seq;
+  AppTimerCallback callback;
+  void *data;
+};
+
+static AppTimer s_timers[MAX_TIMERS];
+static uint32_t s_timer_seq;
+
+static AppTimer *add_timer(uint64_t due, AppTimerCallback callback, void *data, bool app){
+  for(int i = 0; i < MAX_TIMERS; i++){
+    if(!s_timers[i].used){
+      s_timers[i] = (AppTimer) {
+        .used = true,
+        .app = app,
+        .due = due,
+        .seq = s_timer_seq++,
+        .callback = callback,
+        .data = data
+      };
+      return &s_timers[i];
+    }
+  }
+  fprintf(stderr, "host: out of timers\n");
+  abort();
+}
+
+static AppTimer *next_timer(void){
+  AppTimer *next = NULL;
+  for(int i = 0; i < MAX_TIMERS; i++){
+    AppTimer *timer = &s_timers[i];
+    if(timer->used && (next == NULL || timer->due < next->due ||
+                       (timer->due == next->due && timer->seq < next->seq))){
+      next = timer;
+    }
+  }
+  return next;
+}
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *data){
+  return add_timer(s_now_ms + timeout_ms, callback, data, true);
+}
+
+bool app_timer_reschedule(AppTimer *timer, uint32_t new_timeout_ms){
+  if(!timer->used){
+    return false;
+  }
+  timer->due = s_now_ms + new_timeout_ms;
+  timer->seq = s_timer_seq++;
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer){
+  timer->used = false;
+}
+
+void host_after(uint32_t delay_ms, void (*fn)(void *data), void *data){
+  add_timer(s_now_ms + delay_ms, fn, data, false);
+}
+
+// Clock and ticks
+
+static TickHandler s_tick_handler;
+static TimeUnits s_tick_units;
+static uint64_t s_next_tick_ms;
+
+static uint64_t tick_period_ms(void){
+  if(s_tick_units & SECOND_UNIT){
+    return 1000;
+  }
+  if(s_tick_units & MINUTE_UNIT){
+    return 60 * 1000;
+  }
+  if(s_tick_units & HOUR_UNIT){
+    return 60 * 60 * 1000;
+  }
+  return 24 * 60 * 60 * 1000;
+}
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler){
+  s_tick_units = tick_units;
+  s_tick_handler = handler;
+  s_next_tick_ms = (s_now_ms / tick_period_ms() + 1) * tick_period_ms();
+}
+
+void tick_timer_service_unsubscribe(void){
+  s_tick_handler = NULL;
+}
+
+static void fire_tick(void){
+  time_t now = s_now_ms / 1000;
+  struct tm t;
+  localtime_r(&now, &t);
+  TimeUnits changed = SECOND_UNIT;
+  if(t.tm_sec == 0){
+    changed |= MINUTE_UNIT;
+    if(t.tm_min == 0){
+      changed |= HOUR_UNIT;
+      if(t.tm_hour == 0){
+        changed |= DAY_UNIT;
+        if(t.tm_mday == 1){
+          changed |= MONTH_UNIT;
+          if(t.tm_mon == 0){
+            changed |= YEAR_UNIT;
+          }
+        }
+      }
+    }
+  }
+  // The handler may resubscribe
+  s_next_tick_ms += tick_period_ms();
+  app_enter();
+  s_tick_handler(&t, changed);
+  app_leave();
+}
+
+void host_set_clock(uint64_t now_ms){
+  setenv("TZ", "UTC", 1);
+  tzset();
+  s_now_ms = now_ms;
+}
+
+uint64_t host_clock(void){
+  return s_now_ms;
+}
+
+void host_run_until(uint64_t at_ms){
+  for(;;){
+    AppTimer *timer = next_timer();
+    uint64_t tick = s_tick_handler != NULL ? s_next_tick_ms : UINT64_MAX;
+    if(timer != NULL && timer->due <= tick && timer->due <= at_ms){
+      if(timer->due > s_now_ms){
+        s_now_ms = timer->due;
+      }
+      AppTimer fired = *timer;
+      timer->used = false;
+      if(fired.app){
+        app_enter();
+        fired.callback(fired.data);
+        app_leave();
+      }else{
+        fired.callback(fired.data);
+      }
+    }else if(tick <= at_ms){
+      s_now_ms = tick;
+      fire_tick();
+    }else{
+      break;
+    }
+  }
+  if(at_ms > s_now_ms){
+    s_now_ms = at_ms;
+  }
+}
+
+time_t host_time(time_t *t){
+  time_t now = s_now_ms / 1000;
+  if(t != NULL){
+    *t = now;
+  }
+  return now;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms){
+  uint16_t ms = s_now_ms % 1000;
+  if(tloc != NULL){
+    *tloc = s_now_ms / 1000;
+  }
+  if(out_ms != NULL){
+    *out_ms = ms;
+  }
+  return ms;
+}
+
+// Event services
+
+static AccelTapHandler s_tap_handler;
+static BatteryStateHandler s_battery_handler;
+static BatteryChargeState s_battery = {
+  .charge_percent = 80,
+  .is_charging = false,
+  .is_plugged = false
+};
+static BluetoothConnectionHandler s_bt_handler;
+static bool s_connected = true;
+
+void accel_tap_service_subscribe(AccelTapHandler handler){
+  s_tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe(void){
+  s_tap_handler = NULL;
+}
+
+BatteryChargeState battery_state_service_peek(void){
+  return s_battery;
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler){
+  s_battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void){
+  s_battery_handler = NULL;
+}
+
+bool bluetooth_connection_service_peek(void){
+  return s_connected;
+}
+
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler){
+  s_bt_handler = handler;
+}
+
+void bluetooth_connection_service_unsubscribe(void){
+  s_bt_handler = NULL;
+}
+
+void vibes_short_pulse(void){
+}
+
+void host_tap(void){
+  if(s_tap_handler != NULL){
+    app_enter();
+    s_tap_handler(ACCEL_AXIS_Z, 1);
+    app_leave();
+  }
+}
+
+void host_set_bluetooth(bool connected){
+  if(connected == s_connected){
+    return;
+  }
+  s_connected = connected;
+  if(s_bt_handler != NULL){
+    app_enter();
+    s_bt_handler(connected);
+    app_leave();
+  }
+}
+
+void host_set_battery(BatteryChargeState state){
+  s_battery = state;
+  if(s_battery_handler != NULL){
+    app_enter();
+    s_battery_handler(state);
+    app_leave();
+  }
+}
+
+// AppMessage, over a link that acknowledges after HOST_ACK_MS
+
+#define HOST_ACK_MS 100
+#define MAX_TUPLES 16
+
+struct DictionaryIterator {
+  Tuple *tuples[MAX_TUPLES];
+  int count;
+  int cursor;
+};
+
+static DictionaryIterator s_outbox;
+static bool s_outbox_busy;
+static AppMessageInboxReceived s_inbox_received;
+static AppMessageInboxDropped s_inbox_dropped;
+static AppMessageOutboxSent s_outbox_sent;
+static AppMessageOutboxFailed s_outbox_failed;
+
+static Tuple *tuple_create(uint32_t key, TupleType type, const void *data, uint16_t length){
+  Tuple *tuple = malloc(sizeof(Tuple) + length);
+  tuple->key = key;
+  tuple->type = type;
+  tuple->length = length;
+  memcpy(tuple->value->data, data, length);
+  return tuple;
+}
+
+static void dict_clear(DictionaryIterator *iter){
+  for(int i = 0; i < iter->count; i++){
+    free(iter->tuples[i]);
+  }
+  iter->count = 0;
+  iter->cursor = 0;
+}
+
+Tuple *host_tuple_int(uint32_t key, int32_t value){
+  return tuple_create(key, TUPLE_INT, &value, sizeof(value));
+}
+
+Tuple *host_tuple_bytes(uint32_t key, const uint8_t *data, uint16_t length){
+  return tuple_create(key, TUPLE_BYTE_ARRAY, data, length);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, uint32_t key, uint8_t value){
+  if(iter->count == MAX_TUPLES){
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  iter->tuples[iter->count++] = tuple_create(key, TUPLE_UINT, &value, sizeof(value));
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, uint32_t key, const uint8_t *data, uint16_t size){
+  if(iter->count == MAX_TUPLES){
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  iter->tuples[iter->count++] = tuple_create(key, TUPLE_BYTE_ARRAY, data, size);
+  return DICT_OK;
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter){
+  iter->cursor = 0;
+  return iter->count > 0 ? iter->tuples[0] : NULL;
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter){
+  iter->cursor++;
+  return iter->cursor < iter->count ? iter->tuples[iter->cursor] : NULL;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, uint32_t key){
+  for(int i = 0; i < iter->count; i++){
+    if(iter->tuples[i]->key == key){
+      return iter->tuples[i];
+    }
+  }
+  return NULL;
+}
+
+AppMessageResult app_message_open(uint32_t size_inbound, uint32_t size_outbound){
+  return APP_MSG_OK;
+}
+
+uint32_t app_message_inbox_size_maximum(void){
+  return 256;
+}
+
+uint32_t app_message_outbox_size_maximum(void){
+  return 256;
+}
+
+void app_message_register_inbox_received(AppMessageInboxReceived callback){
+  s_inbox_received = callback;
+}
+
+void app_message_register_inbox_dropped(AppMessageInboxDropped callback){
+  s_inbox_dropped = callback;
+}
+
+void app_message_register_outbox_sent(AppMessageOutboxSent callback){
+  s_outbox_sent = callback;
+}
+
+void app_message_register_outbox_failed(AppMessageOutboxFailed callback){
+  s_outbox_failed = callback;
+}
+
+void app_message_deregister_callbacks(void){
+  s_inbox_received = NULL;
+  s_inbox_dropped = NULL;
+  s_outbox_sent = NULL;
+  s_outbox_failed = NULL;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator){
+  if(s_outbox_busy){
+    return APP_MSG_BUSY;
+  }
+  dict_clear(&s_outbox);
+  *iterator = &s_outbox;
+  return APP_MSG_OK;
+}
+
+// The phone sees the message, then the watch gets the ack, or a failure if
+// the phone is gone
+static void outbox_ack(void *data){
+  s_outbox_busy = false;
+  if(s_connected){
+    if(s_phone != NULL){
+      s_phone(&s_outbox);
+    }
+    if(s_outbox_sent != NULL){
+      app_enter();
+      s_outbox_sent(&s_outbox, NULL);
+      app_leave();
+    }
+  }else if(s_outbox_failed != NULL){
+    app_enter();
+    s_outbox_failed(&s_outbox, APP_MSG_NOT_CONNECTED, NULL);
+    app_leave();
+  }
+}
+
+AppMessageResult app_message_outbox_send(void){
+  if(s_outbox_busy){
+    return APP_MSG_BUSY;
+  }
+  s_outbox_busy = true;
+  host_stats.messages_sent++;
+  host_after(HOST_ACK_MS, outbox_ack, NULL);
+  return APP_MSG_OK;
+}
+
+void host_set_phone(HostPhone phone){
+  s_phone = phone;
+}
+
+void host_receive(Tuple **tuples, int num_tuples){
+  DictionaryIterator inbox = { .count = num_tuples };
+  memcpy(inbox.tuples, tuples, num_tuples * sizeof(Tuple *));
+  // Lost with the connection
+  if(s_connected && s_inbox_received != NULL){
+    host_stats.messages_received++;
+    app_enter();
+    s_inbox_received(&inbox, NULL);
+    app_leave();
+  }
+  dict_clear(&inbox);
+}
+
+// Storage, one flash write per write or delete
+
+#define MAX_PERSIST_KEYS 16
+
+typedef struct {
+  bool used;
+  uint32_t key;
+  uint16_t length;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} PersistEntry;
+
+static PersistEntry s_persist[MAX_PERSIST_KEYS];
+
+static PersistEntry *persist_find(uint32_t key){
+  for(int i = 0; i < MAX_PERSIST_KEYS; i++){
+    if(s_persist[i].used && s_persist[i].key == key){
+      return &s_persist[i];
+    }
+  }
+  return NULL;
+}
+
+bool persist_exists(uint32_t key){
+  return persist_find(key) != NULL;
+}
+
+int persist_read_data(uint32_t key, void *buffer, size_t buffer_size){
+  PersistEntry *entry = persist_find(key);
+  if(entry == NULL){
+    return E_DOES_NOT_EXIST;
+  }
+  size_t length = entry->length < buffer_size ? entry->length : buffer_size;
+  memcpy(buffer, entry->data, length);
+  return length;
+}
+
+int32_t persist_read_int(uint32_t key){
+  int32_t value = 0;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+bool persist_read_bool(uint32_t key){
+  bool value = false;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+int persist_write_data(uint32_t key, const void *data, size_t size){
+  PersistEntry *entry = persist_find(key);
+  for(int i = 0; entry == NULL && i < MAX_PERSIST_KEYS; i++){
+    if(!s_persist[i].used){
+      entry = &s_persist[i];
+    }
+  }
+  if(entry == NULL){
+    return E_DOES_NOT_EXIST;
+  }
+  if(size > PERSIST_DATA_MAX_LENGTH){
+    size = PERSIST_DATA_MAX_LENGTH;
+  }
+  entry->used = true;
+  entry->key = key;
+  entry->length = size;
+  memcpy(entry->data, data, size);
+  host_stats.flash_writes++;
+  return size;
+}
+
+StatusCode persist_write_int(uint32_t key, int32_t value){
+  persist_write_data(key, &value, sizeof(value));
+  return S_SUCCESS;
+}
+
+StatusCode persist_write_bool(uint32_t key, bool value){
+  persist_write_data(key, &value, sizeof(value));
+  return S_SUCCESS;
+}
+
+StatusCode persist_delete(uint32_t key){
+  PersistEntry *entry = persist_find(key);
+  if(entry == NULL){
+    return E_DOES_NOT_EXIST;
+  }
+  entry->used = false;
+  host_stats.flash_writes++;
+  return S_SUCCESS;
+}
+
+// Logging and the app lifecycle
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...){
+  if(getenv("HOST_LOG") == NULL){
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "%s:%d ", src_filename, src_line_number);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+void host_set_scenario(HostScenario scenario){
+  s_scenario = scenario;
+}
+
+void app_event_loop(void){
+  // init ran as one event
+  host_stats.wakeups++;
+  render();
+  if(s_scenario != NULL){
+    s_scenario();
+  }
+}
+
+// The face is built with PROFILE_RENDER for the cell grid's work counters;
+// time is measured by the runtime instead
+
+uint32_t profile_now(void){
+  return (uint32_t)s_now_ms;
+}
+
+void profile_record(ProfileSection section, uint32_t start){
+}
+
+void profile_count(ProfileCounter counter, uint32_t value){
+  if(counter == PROFILE_FILL_CALLS){
+    host_stats.fill_calls += value;
+  }else if(counter == PROFILE_CELLS_PAINTED){
+    host_stats.cells_painted += value;
+  }
+}
+
+void profile_tally(ProfileTally tally){
+}
+
+void profile_dump(void){
+}
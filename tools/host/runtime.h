@@ -0,0 +1,87 @@
+#pragma once
+
+#include <pebble.h>
+
+// Fake Pebble runtime for host builds of the watchface. Time is a virtual
+// clock that only moves when a tool runs it forward; timers, ticks and
+// AppMessage deliveries fire in order as it passes them, and every app
+// callback is followed by a frame if a layer was marked dirty, as on the
+// watch. Frames are rendered into an 8 bit framebuffer of the platform's size.
+//
+// main.c is compiled with main renamed to watchface_main. A tool sets its
+// scenario and calls watchface_main: init runs as usual, then
+// app_event_loop hands control to the scenario, and deinit runs once it
+// returns.
+
+#if defined(PBL_ROUND)
+#define HOST_SCREEN_W 180
+#define HOST_SCREEN_H 180
+#else
+#define HOST_SCREEN_W 144
+#define HOST_SCREEN_H 168
+#endif
+
+// A PNG resource as the SDK would pack it, generated by resources.py
+#define HOST_NUM_RESOURCES (RESOURCE_ID_BT2 + 1)
+typedef struct {
+  GSize size;
+  GBitmapFormat format;
+  uint16_t row_size;
+  uint8_t palette[16];
+  uint8_t num_colors;
+  const uint8_t *data;
+} HostResource;
+
+extern const HostResource HOST_RESOURCES[HOST_NUM_RESOURCES];
+
+// Everything the app cost since the start, counted by the runtime itself
+typedef struct {
+  // App callbacks dispatched: ticks, timers, service events, AppMessages
+  uint32_t wakeups;
+  // Frames rendered
+  uint32_t redraws;
+  // From the cell grid's profiling hooks
+  uint32_t cells_painted;
+  uint32_t fill_calls;
+  uint32_t messages_sent;
+  uint32_t messages_received;
+  uint32_t resource_loads;
+  // persist writes and deletes
+  uint32_t flash_writes;
+  // Host time spent in app callbacks and update procs
+  uint64_t app_ns;
+} HostStats;
+
+extern HostStats host_stats;
+
+typedef void (*HostScenario)(void);
+// Receives every message the watch sends while the phone is connected
+typedef void (*HostPhone)(DictionaryIterator *message);
+
+int watchface_main(void);
+void host_set_scenario(HostScenario scenario);
+void host_set_phone(HostPhone phone);
+
+// Virtual clock in ms since the epoch, in UTC
+void host_set_clock(uint64_t now_ms);
+uint64_t host_clock(void);
+// Fire everything due up to at_ms, in order, then leave the clock there
+void host_run_until(uint64_t at_ms);
+// Run fn once the clock passes now + delay_ms; not an app wakeup by itself
+void host_after(uint32_t delay_ms, void (*fn)(void *data), void *data);
+
+// Events as the firmware delivers them
+void host_tap(void);
+void host_set_bluetooth(bool connected);
+void host_set_battery(BatteryChargeState state);
+// Deliver a message from the phone; takes ownership of the tuples
+void host_receive(Tuple **tuples, int num_tuples);
+Tuple *host_tuple_int(uint32_t key, int32_t value);
+Tuple *host_tuple_bytes(uint32_t key, const uint8_t *data, uint16_t length);
+
+// Direct drawing, for tools that call into the renderer themselves
+GBitmap *host_framebuffer(void);
+GContext *host_context(void);
+// A bitmap with rows of row_size bytes starting offset bytes into the
+// allocation, to test unaligned data; 8BitCircular rows are clipped to a circle
+GBitmap *host_bitmap_create(GSize size, GBitmapFormat format, uint16_t row_size, uint16_t offset);
@@ -0,0 +1,194 @@
+#include "runtime.h"
+#include "pixel_grid.h"
+#include "settings.h"
+#include "theme.h"
+#include <stddef.h>
+
+// Time-warp simulator: runs the face for simulated hours of a wearer's day
+// in a second or so, and reports what it cost. Starting on a Monday at
+// 06:00 on a full battery, it injects:
+//   taps, every half hour or so while awake and rarely at night;
+//   bluetooth drops of a few to tens of minutes, every six hours or so;
+//   the battery draining a tenth at a time, and charging overnight;
+//   a theme change from the phone, ten hours in.
+// The phone answers weather requests two seconds after they arrive, if
+// still connected. Events come from a seeded generator, so a run is
+// repeatable and two builds or settings see the same day.
+//
+// Prints CSV, per metric the total and the rate per simulated hour:
+//   sim,hours,seed,taps,bt_drops,battery_events
+//   metric,name,total,per_hour
+//
+// Usage: sim [hours=30] [seed=1] [<setting>=<value>...]
+// where the settings are fields of Settings, such as sweep_seconds=1.
+
+#define START_TIME 1767592800 // Mon 2026-01-05 06:00 UTC
+#define PHONE_REPLY_MS 2000
+// Battery drain and charge, in tenths of a percent per minute
+#define DRAIN_PER_MINUTE 1
+#define CHARGE_PER_MINUTE 15
+#define CHARGER_ON_HOUR 23
+#define CHARGER_OFF_HOUR 7
+
+typedef struct {
+  const char *name;
+  size_t offset;
+} SettingField;
+
+#define FIELD(name) {#name, offsetof(Settings, name)}
+static const SettingField SETTING_FIELDS[] = {
+  FIELD(seconds_color), FIELD(minutes_color), FIELD(hours_color), FIELD(bt_image_type),
+  FIELD(temp_scale), FIELD(date_format), FIELD(hide_second_hand), FIELD(show_animation),
+  FIELD(weather_mode), FIELD(square_face), FIELD(seconds_timeout), FIELD(theme),
+  FIELD(sweep_seconds)
+};
+
+static uint32_t s_hours = 30;
+static uint32_t s_seed = 1;
+static uint32_t s_random;
+
+static uint32_t s_taps;
+static uint32_t s_bt_drops;
+static uint32_t s_battery_events;
+
+// xorshift, independent of the app's own use of rand()
+static uint32_t next_random(void){
+  s_random ^= s_random << 13;
+  s_random ^= s_random >> 17;
+  s_random ^= s_random << 5;
+  return s_random;
+}
+
+static bool chance(uint32_t one_in){
+  return next_random() % one_in == 0;
+}
+
+static void phone_reply(void *data){
+  Tuple *tuples[] = {
+    host_tuple_int(WEATHER_MESSAGE, 1),
+    host_tuple_int(KEY_TEMPERATURE, 5 + (int32_t)(next_random() % 10))
+  };
+  host_receive(tuples, ARRAY_LENGTH(tuples));
+}
+
+static void phone(DictionaryIterator *message){
+  if(dict_find(message, WEATHER_MESSAGE) != NULL){
+    host_after(PHONE_REPLY_MS, phone_reply, NULL);
+  }
+}
+
+static void send_theme(uint8_t theme){
+  const uint8_t packed[] = {CONFIG_SCHEMA_VERSION, KEY_THEME, theme};
+  Tuple *tuples[] = {host_tuple_bytes(KEY_CONFIG_PACKED, packed, sizeof(packed))};
+  host_receive(tuples, ARRAY_LENGTH(tuples));
+}
+
+static void run(void){
+  HostStats start = host_stats;
+  uint64_t start_ms = host_clock();
+  // Tenths of a percent, to drain smoothly between the reported tenths
+  int32_t charge = 1000;
+  BatteryChargeState battery = battery_state_service_peek();
+  bool connected = true;
+
+  for(uint32_t minute = 0; minute < s_hours * 60; minute++){
+    uint64_t minute_ms = start_ms + (uint64_t)minute * 60 * 1000;
+    uint32_t hour = (START_TIME / 3600 + minute / 60) % 24;
+    bool awake = hour >= CHARGER_OFF_HOUR && hour < CHARGER_ON_HOUR;
+
+    // Somewhere within the minute
+    host_run_until(minute_ms + next_random() % (60 * 1000));
+    if(chance(awake ? 30 : 240)){
+      host_tap();
+      s_taps++;
+    }
+    if(connected ? chance(360) : chance(15)){
+      connected = !connected;
+      s_bt_drops += !connected;
+      host_set_bluetooth(connected);
+    }
+    if(minute == 10 * 60){
+      send_theme(THEME_FOREST);
+    }
+
+    bool plugged = !awake;
+    charge += plugged ? CHARGE_PER_MINUTE : -DRAIN_PER_MINUTE;
+    charge = charge > 1000 ? 1000 : charge < 0 ? 0 : charge;
+    BatteryChargeState now = {
+      .charge_percent = charge / 100 * 10,
+      .is_charging = plugged && charge < 1000,
+      .is_plugged = plugged
+    };
+    if(now.charge_percent != battery.charge_percent || now.is_charging != battery.is_charging ||
+       now.is_plugged != battery.is_plugged){
+      battery = now;
+      host_set_battery(battery);
+      s_battery_events++;
+    }
+  }
+  host_run_until(start_ms + (uint64_t)s_hours * 60 * 60 * 1000);
+
+  printf("sim,%u,%u,%u,%u,%u\n", s_hours, s_seed, s_taps, s_bt_drops, s_battery_events);
+  #define METRIC(name, value) \
+    printf("metric,%s,%llu,%.1f\n", name, (unsigned long long)(value), (double)(value) / s_hours)
+  METRIC("wakeups", host_stats.wakeups - start.wakeups);
+  METRIC("redraws", host_stats.redraws - start.redraws);
+  METRIC("cells_painted", host_stats.cells_painted - start.cells_painted);
+  METRIC("fill_calls", host_stats.fill_calls - start.fill_calls);
+  METRIC("messages_sent", host_stats.messages_sent - start.messages_sent);
+  METRIC("messages_received", host_stats.messages_received - start.messages_received);
+  METRIC("resource_loads", host_stats.resource_loads - start.resource_loads);
+  METRIC("flash_writes", host_stats.flash_writes - start.flash_writes);
+  METRIC("app_us", (host_stats.app_ns - start.app_ns) / 1000);
+}
+
+static bool set_field(Settings *settings, const char *arg){
+  const char *eq = strchr(arg, '=');
+  if(eq == NULL){
+    return false;
+  }
+  size_t length = eq - arg;
+  uint32_t value = strtoul(eq + 1, NULL, 10);
+  if(length == 5 && strncmp(arg, "hours", 5) == 0){
+    s_hours = value;
+    return value > 0;
+  }
+  if(length == 4 && strncmp(arg, "seed", 4) == 0){
+    s_seed = value;
+    return value > 0;
+  }
+  for(unsigned i = 0; i < ARRAY_LENGTH(SETTING_FIELDS); i++){
+    if(strlen(SETTING_FIELDS[i].name) == length && strncmp(arg, SETTING_FIELDS[i].name, length) == 0){
+      ((uint8_t *)settings)[SETTING_FIELDS[i].offset] = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv){
+  host_set_clock((uint64_t)START_TIME * 1000);
+
+  // The settings as a user left them, before the face starts
+  Settings settings;
+  settings_load(&settings);
+  for(int i = 1; i < argc; i++){
+    if(!set_field(&settings, argv[i])){
+      fprintf(stderr, "sim: bad argument %s\nusage: %s [hours=30] [seed=1] [<setting>=<value>...]\n",
+              argv[i], argv[0]);
+      return 2;
+    }
+  }
+  settings_save(&settings);
+  s_random = s_seed;
+  host_set_battery((BatteryChargeState) {
+    .charge_percent = 100,
+    .is_charging = false,
+    .is_plugged = false
+  });
+
+  host_set_phone(phone);
+  host_set_scenario(run);
+  watchface_main();
+  return 0;
+}
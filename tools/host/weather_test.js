@@ -0,0 +1,201 @@
+// Tests of src/weather.js against a stub weather server on localhost: the
+// reading cache and its expiry, one fetch shared by concurrent requests, and
+// the timeout, non-200 and malformed responses. Geolocation, storage and the
+// clock are faked; XMLHttpRequest is a thin shim over node's http.
+//
+// Usage: node weather_test.js
+
+var assert = require('assert');
+var http = require('http');
+var createWeatherService = require('../../src/weather.js');
+
+// What the stub server does with the next requests: respond(res) or nothing
+var respond;
+var requests = 0;
+
+function kelvin(celsius) {
+  return function(res) {
+    res.writeHead(200, {'Content-Type': 'application/json'});
+    res.end(JSON.stringify({main: {temp: celsius + 273.15}}));
+  };
+}
+
+function XhrShim() {
+  this.status = 0;
+  this.responseText = '';
+}
+XhrShim.prototype.open = function(method, url) {
+  this.url = url;
+};
+XhrShim.prototype.send = function() {
+  var xhr = this;
+  this.request = http.get(this.url, function(res) {
+    var body = '';
+    res.setEncoding('utf8');
+    res.on('data', function(chunk) {
+      body += chunk;
+    });
+    res.on('end', function() {
+      xhr.status = res.statusCode;
+      xhr.responseText = body;
+      xhr.onload();
+    });
+  });
+  this.request.on('error', function() {
+    xhr.onerror();
+  });
+};
+XhrShim.prototype.abort = function() {
+  this.request.destroy();
+};
+
+function memoryStorage() {
+  var items = {};
+  return {
+    getItem: function(key) {
+      return key in items ? items[key] : null;
+    },
+    setItem: function(key, value) {
+      items[key] = String(value);
+    }
+  };
+}
+
+var geolocation = {
+  getCurrentPosition: function(success) {
+    setImmediate(success, {coords: {latitude: 51.5, longitude: -0.12}});
+  }
+};
+
+// A fresh service with empty storage, on a clock the test moves by hand
+function service(port, clock) {
+  return createWeatherService({
+    geolocation: geolocation,
+    XMLHttpRequest: XhrShim,
+    localStorage: memoryStorage(),
+    now: function() {
+      return clock.ms;
+    },
+    baseUrl: 'http://127.0.0.1:' + port + '/weather',
+    ttlMs: 60 * 1000,
+    timeoutMs: 200
+  });
+}
+
+function get(weather) {
+  return new Promise(function(resolve) {
+    weather.get(function(err, celsius) {
+      resolve({err: err, celsius: celsius});
+    });
+  });
+}
+
+var tests = [
+  ['cached until the reading expires', function(port) {
+    var clock = {ms: 0};
+    var weather = service(port, clock);
+    respond = kelvin(12);
+    return get(weather).then(function(result) {
+      assert.deepStrictEqual(result, {err: null, celsius: 12});
+      assert.strictEqual(requests, 1);
+      clock.ms += 59 * 1000;
+      respond = kelvin(20);
+      return get(weather);
+    }).then(function(result) {
+      assert.deepStrictEqual(result, {err: null, celsius: 12});
+      assert.strictEqual(requests, 1);
+      clock.ms += 2 * 1000;
+      return get(weather);
+    }).then(function(result) {
+      assert.deepStrictEqual(result, {err: null, celsius: 20});
+      assert.strictEqual(requests, 2);
+    });
+  }],
+
+  ['concurrent requests share one fetch', function(port) {
+    var weather = service(port, {ms: 0});
+    // Long enough for any duplicate fetch to reach the server
+    respond = function(res) {
+      setTimeout(kelvin(7), 50, res);
+    };
+    return Promise.all([get(weather), get(weather), get(weather)]).then(function(results) {
+      results.forEach(function(result) {
+        assert.deepStrictEqual(result, {err: null, celsius: 7});
+      });
+      assert.strictEqual(requests, 1);
+    });
+  }],
+
+  ['a slow server times out', function(port) {
+    var weather = service(port, {ms: 0});
+    respond = function(res) {
+      setTimeout(kelvin(7), 1000, res);
+    };
+    return get(weather).then(function(result) {
+      assert.strictEqual(result.err, 'timed out');
+    });
+  }],
+
+  ['a non-200 response is an error and not cached', function(port) {
+    var weather = service(port, {ms: 0});
+    respond = function(res) {
+      res.writeHead(503);
+      res.end();
+    };
+    return get(weather).then(function(result) {
+      assert.strictEqual(result.err, 'HTTP 503');
+      respond = kelvin(3);
+      return get(weather);
+    }).then(function(result) {
+      assert.deepStrictEqual(result, {err: null, celsius: 3});
+      assert.strictEqual(requests, 2);
+    });
+  }],
+
+  ['a malformed response is an error', function(port) {
+    var weather = service(port, {ms: 0});
+    var bodies = ['not json', '{}', '{"main": {"temp": "warm"}}'];
+    function next() {
+      if(bodies.length === 0) {
+        return Promise.resolve();
+      }
+      var body = bodies.shift();
+      respond = function(res) {
+        res.writeHead(200);
+        res.end(body);
+      };
+      return get(weather).then(function(result) {
+        assert.strictEqual(result.err, 'bad response', body);
+        return next();
+      });
+    }
+    return next();
+  }]
+];
+
+var server = http.createServer(function(req, res) {
+  requests++;
+  respond(res);
+});
+
+server.listen(0, '127.0.0.1', function() {
+  var port = server.address().port;
+  var failures = 0;
+  var run = Promise.resolve();
+  tests.forEach(function(test) {
+    run = run.then(function() {
+      requests = 0;
+      return test[1](port);
+    }).then(function() {
+      console.log('weather,' + test[0] + ',ok');
+    }, function(e) {
+      console.log('weather,' + test[0] + ',FAILED: ' + e.message);
+      failures++;
+    });
+  });
+  run.then(function() {
+    server.closeAllConnections();
+    server.close();
+    process.exitCode = failures === 0 ? 0 : 1;
+  });
+});